@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QtGlobal>
+
+#define NUM_INPUT_COLUMNS 6
+#define FRAMECOUNT_COLUMN 1
+
+enum class Centering
+{
+    Unknown = 0,
+    Seven,
+    Zero,
+};
+
+#define NUM_CENTERINGS 3
+
+enum class ColumnKind : quint8
+{
+    Button,
+    Stick,
+    DPad,
+};
+
+struct ColumnInfo
+{
+    const char* name;
+    ColumnKind kind;
+    int width;
+};
+
+// The TTK CSV layout in file order: everything about a column that parsing, validation, the
+// table model and the window layout need. Another layout is another table of this shape.
+constexpr ColumnInfo TTK_COLUMNS[NUM_INPUT_COLUMNS] =
+{
+    { "A", ColumnKind::Button, 20 },
+    { "B", ColumnKind::Button, 20 },
+    { "L", ColumnKind::Button, 20 },
+    { "LR", ColumnKind::Stick, 25 },
+    { "UD", ColumnKind::Stick, 25 },
+    { "DPad", ColumnKind::DPad, 35 },
+};
+
+// Buttons are 0/1, the DPad is 0-4 and sticks follow the centering (-7..14 while it is still unknown)
+constexpr int kindMin(ColumnKind kind, Centering centering)
+{
+    return (kind == ColumnKind::Stick && centering != Centering::Seven) ? -7 : 0;
+}
+
+constexpr int kindMax(ColumnKind kind, Centering centering)
+{
+    return (kind == ColumnKind::Button) ? 1
+        : (kind == ColumnKind::DPad) ? 4
+        : (centering == Centering::Zero) ? 7 : 14;
+}
+
+constexpr bool isStickColumn(int col)
+{
+    return TTK_COLUMNS[col].kind == ColumnKind::Stick;
+}
+
+constexpr bool isButtonColumn(int col)
+{
+    return TTK_COLUMNS[col].kind == ColumnKind::Button;
+}
+
+constexpr int columnWidthSum(int firstCol = 0)
+{
+    return (firstCol == NUM_INPUT_COLUMNS) ? 0 : TTK_COLUMNS[firstCol].width + columnWidthSum(firstCol + 1);
+}
+
+// Every column's accepted range for one centering, so checking a cell is two loads rather than
+// a branch on the column. One table per centering is generated from TTK_COLUMNS at compile time.
+struct ValueBounds
+{
+    int min[NUM_INPUT_COLUMNS];
+    int max[NUM_INPUT_COLUMNS];
+};
+
+template <int... Cols>
+struct ColumnSequence
+{
+};
+
+template <int N, int... Cols>
+struct MakeColumnSequence : MakeColumnSequence<N - 1, N - 1, Cols...>
+{
+};
+
+template <int... Cols>
+struct MakeColumnSequence<0, Cols...>
+{
+    typedef ColumnSequence<Cols...> type;
+};
+
+template <int... Cols>
+constexpr ValueBounds makeValueBounds(Centering centering, ColumnSequence<Cols...>)
+{
+    return ValueBounds{ { kindMin(TTK_COLUMNS[Cols].kind, centering)... }, { kindMax(TTK_COLUMNS[Cols].kind, centering)... } };
+}
+
+constexpr ValueBounds VALUE_BOUNDS[NUM_CENTERINGS] =
+{
+    makeValueBounds(Centering::Unknown, MakeColumnSequence<NUM_INPUT_COLUMNS>::type()),
+    makeValueBounds(Centering::Seven, MakeColumnSequence<NUM_INPUT_COLUMNS>::type()),
+    makeValueBounds(Centering::Zero, MakeColumnSequence<NUM_INPUT_COLUMNS>::type()),
+};
+
+static inline const ValueBounds& boundsFor(Centering centering)
+{
+    return VALUE_BOUNDS[static_cast<int>(centering)];
+}
+
+static_assert(VALUE_BOUNDS[static_cast<int>(Centering::Seven)].max[3] == 14, "Sticks in a 7-centered file go up to 14");
+static_assert(VALUE_BOUNDS[static_cast<int>(Centering::Zero)].min[4] == -7, "Sticks in a 0-centered file go down to -7");
+static_assert(VALUE_BOUNDS[static_cast<int>(Centering::Unknown)].max[5] == 4, "The DPad is 0-4 whatever the centering");
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QtEndian>
+#include <QtGlobal>
+
+#include <cstring>
+
+#define FNV1A64_OFFSET_BASIS 14695981039346656037ULL
+#define FNV1A64_PRIME 1099511628211ULL
+
+// 64-bit FNV-1a, used to tie sidecar files to the exact bytes of the file they describe.
+// Pass the previous result as the seed to hash data that arrives in pieces.
+inline quint64 contentHash(const char* data, qint64 len, quint64 seed = FNV1A64_OFFSET_BASIS)
+{
+    quint64 hash = seed;
+
+    for (qint64 i = 0; i < len; i++)
+    {
+        hash ^= static_cast<quint8>(data[i]);
+        hash *= FNV1A64_PRIME;
+    }
+
+    return hash;
+}
+
+// Word-at-a-time variant for large binary payloads, several times faster than the
+// byte-wise hash above. Words are read little-endian so the result is the same on any
+// machine. When hashing in pieces, every piece but the last must be a multiple of 8 bytes
+// long for the result to match hashing everything at once.
+inline quint64 blockChecksum(const char* data, qint64 len, quint64 seed = FNV1A64_OFFSET_BASIS)
+{
+    quint64 hash = seed;
+    qint64 i = 0;
+
+    for (; i + 8 <= len; i += 8)
+    {
+        quint64 word = qFromLittleEndian<quint64>(data + i);
+        hash = (hash ^ word) * FNV1A64_PRIME;
+        hash ^= hash >> 29;
+    }
+
+    return contentHash(data + i, len - i, hash);
+}
@@ -0,0 +1,47 @@
+// Stand-in for the emulator side of the frame cursor channel. Publishes a frame index
+// advancing at a fixed rate so cursor following can be tested without Dolphin.
+//
+// Usage: ttk-cursor-publisher [start frame] [ghost offset] [rate in Hz]
+
+#include "FrameCursor.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTimer>
+
+#include <iostream>
+
+#define DEFAULT_RATE_HZ 60
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+
+    int frame = (args.count() > 1) ? args[1].toInt() : 0;
+    int ghostOffset = (args.count() > 2) ? args[2].toInt() : 0;
+    int rateHz = (args.count() > 3) ? args[3].toInt() : DEFAULT_RATE_HZ;
+
+    if (rateHz <= 0)
+        rateHz = DEFAULT_RATE_HZ;
+
+    FrameCursorPublisher publisher;
+    if (!publisher.open())
+    {
+        std::cerr << "Could not create the shared memory segment " << FRAME_CURSOR_KEY << std::endl;
+        return 1;
+    }
+
+    QTimer timer;
+    timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&timer, &QTimer::timeout, [&publisher, &frame, ghostOffset]()
+    {
+        publisher.publish(frame, qMax(NO_CURSOR_FRAME, frame + ghostOffset));
+        frame++;
+    });
+    timer.start(1000 / rateHz);
+
+    std::cout << "Publishing from frame " << frame << " at " << rateHz << " Hz, Ctrl+C to stop" << std::endl;
+
+    return a.exec();
+}
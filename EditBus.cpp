@@ -0,0 +1,496 @@
+#include "EditBus.h"
+
+#include "ContentHash.h"
+#include "EditHistory.h"
+#include "InputFile.h"
+
+#include <QAbstractItemModel>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTableView>
+#include <QTimer>
+
+#include <cstring>
+
+#define BUS_MAGIC "TB"
+#define BUS_VERSION 1
+#define BUS_CONNECT_TIMEOUT_MS 200
+#define BUS_ATTACH_ATTEMPTS 3
+#define BUS_REELECT_JITTER_MS 250
+#define BUS_MAX_PAYLOAD (64 * 1024 * 1024)
+
+// Sent by the host to a new instance so it knows which sequence number comes next
+#define BUS_OP_WELCOME 0x80
+
+struct BusHeader
+{
+    char magic[2];
+    quint8 version;
+    quint8 op;
+    quint32 payloadSize;
+    quint32 seq;
+    quint32 sender;
+};
+
+struct BusCell
+{
+    qint32 row;
+    qint8 col;
+    qint8 value;
+    quint16 reserved;
+};
+
+struct BusRange
+{
+    qint32 firstRow;
+    qint32 count;
+};
+
+static_assert(sizeof(BusHeader) == 16, "BusHeader must stay packed for the bus protocol");
+static_assert(sizeof(BusCell) == 8, "BusCell must stay packed for the bus protocol");
+
+static QByteArray makeMessage(quint8 op, quint32 seq, quint32 sender, const QByteArray& payload)
+{
+    BusHeader header;
+    memcpy(header.magic, BUS_MAGIC, sizeof(header.magic));
+    header.version = BUS_VERSION;
+    header.op = op;
+    header.payloadSize = payload.size();
+    header.seq = seq;
+    header.sender = sender;
+
+    QByteArray message(reinterpret_cast<const char*>(&header), sizeof(BusHeader));
+    message.append(payload);
+    return message;
+}
+
+EditBus::EditBus(InputFile* pInputFile, QObject* parent)
+    : QObject(parent)
+    , m_pFile(pInputFile)
+    , m_pServer(nullptr)
+    , m_pHost(nullptr)
+    , m_senderId(static_cast<quint32>(QCoreApplication::applicationPid()))
+    , m_nextSeq(1)
+    , m_lastSeq(0)
+    , m_hostDiskHash(0)
+{
+}
+
+EditBus::~EditBus()
+{
+    detach();
+}
+
+void EditBus::attach()
+{
+    detach();
+
+    QByteArray path = QFileInfo(m_pFile->getPath()).canonicalFilePath().toUtf8();
+    m_serverName = QString("ttk-edit-%1").arg(contentHash(path.constData(), path.size()), 16, 16, QChar('0'));
+    m_nextSeq = 1;
+    m_lastSeq = 0;
+    m_hostDiskHash = 0;
+
+    for (int attempt = 0; attempt < BUS_ATTACH_ATTEMPTS; attempt++)
+    {
+        QLocalSocket* pSocket = new QLocalSocket(this);
+        pSocket->connectToServer(m_serverName);
+
+        if (pSocket->waitForConnected(BUS_CONNECT_TIMEOUT_MS))
+        {
+            m_pHost = pSocket;
+            connect(pSocket, &QLocalSocket::readyRead, this, [this, pSocket]() { onReadyRead(pSocket); });
+            connect(pSocket, &QLocalSocket::disconnected, this, &EditBus::onHostLost);
+            m_pFile->setRemoteWriter(true);
+            return;
+        }
+
+        delete pSocket;
+
+        if (becomeHost())
+            return;
+    }
+
+    // Neither joining nor hosting worked; edit alone rather than not at all
+    m_serverName = "";
+}
+
+bool EditBus::becomeHost()
+{
+    m_pServer = new QLocalServer(this);
+
+    // Only clear the name when nobody answers on it, i.e. a host crashed and left its socket behind
+    if (!m_pServer->listen(m_serverName))
+    {
+        QLocalSocket probe;
+        probe.connectToServer(m_serverName);
+        if (probe.waitForConnected(BUS_CONNECT_TIMEOUT_MS))
+        {
+            delete m_pServer;
+            m_pServer = nullptr;
+            return false;
+        }
+
+        QLocalServer::removeServer(m_serverName);
+
+        if (!m_pServer->listen(m_serverName))
+        {
+            delete m_pServer;
+            m_pServer = nullptr;
+            return false;
+        }
+    }
+
+    connect(m_pServer, &QLocalServer::newConnection, this, &EditBus::onNewConnection);
+    m_pFile->setRemoteWriter(false);
+    return true;
+}
+
+void EditBus::detach()
+{
+    if (m_pHost != nullptr)
+    {
+        m_pHost->disconnect(this);
+        m_pHost->abort();
+        m_pHost->deleteLater();
+        m_pHost = nullptr;
+    }
+
+    for (QLocalSocket* pPeer : m_peers)
+    {
+        pPeer->disconnect(this);
+        pPeer->abort();
+        pPeer->deleteLater();
+    }
+
+    m_peers.clear();
+    m_pending.clear();
+
+    if (m_pServer != nullptr)
+    {
+        m_pServer->close();
+        delete m_pServer;
+        m_pServer = nullptr;
+    }
+
+    m_serverName = "";
+    m_pFile->setRemoteWriter(false);
+}
+
+void EditBus::onNewConnection()
+{
+    while (m_pServer->hasPendingConnections())
+    {
+        QLocalSocket* pPeer = m_pServer->nextPendingConnection();
+        m_peers.append(pPeer);
+
+        connect(pPeer, &QLocalSocket::readyRead, this, [this, pPeer]() { onReadyRead(pPeer); });
+        connect(pPeer, &QLocalSocket::disconnected, this, [this, pPeer]()
+        {
+            m_peers.removeAll(pPeer);
+            m_pending.remove(pPeer);
+            pPeer->deleteLater();
+        });
+
+        pPeer->write(makeMessage(BUS_OP_WELCOME, m_nextSeq - 1, m_senderId, QByteArray()));
+    }
+}
+
+void EditBus::onHostLost()
+{
+    m_pending.remove(m_pHost);
+    m_pHost->deleteLater();
+    m_pHost = nullptr;
+    m_pFile->setRemoteWriter(false);
+
+    // Stagger the takeover so the remaining instances don't all try to host at once
+    QTimer::singleShot(m_senderId % BUS_REELECT_JITTER_MS, this, [this]()
+    {
+        if (!isAttached())
+            return;
+
+        attach();
+
+        // A new host saves what it has; everyone else picks that up from disk
+        if (hasRemoteWriter())
+            emit resyncNeeded();
+        else
+            emit remoteChangesApplied();
+    });
+}
+
+void EditBus::send(BusOp op, const QByteArray& payload)
+{
+    if (!isAttached())
+        return;
+
+    // The host numbers operations; an instance's own are applied already, so it only broadcasts
+    if (m_pHost != nullptr)
+        m_pHost->write(makeMessage(static_cast<quint8>(op), 0, m_senderId, payload));
+    else
+        broadcast(makeMessage(static_cast<quint8>(op), m_nextSeq++, m_senderId, payload));
+}
+
+void EditBus::broadcast(const QByteArray& message)
+{
+    for (QLocalSocket* pPeer : m_peers)
+        pPeer->write(message);
+}
+
+void EditBus::publishCells(const QVector<CellEditAction>& edits)
+{
+    QByteArray payload(edits.count() * static_cast<int>(sizeof(BusCell)), '\0');
+    BusCell* pCells = reinterpret_cast<BusCell*>(payload.data());
+
+    for (int i = 0; i < edits.count(); i++)
+    {
+        pCells[i].row = edits[i].row();
+        pCells[i].col = static_cast<qint8>(edits[i].col());
+        pCells[i].value = static_cast<qint8>(edits[i].curNumber());
+    }
+
+    send(BusOp::Cells, payload);
+}
+
+void EditBus::publishCell(int rowIdx, int colIdx, int value)
+{
+    BusCell cell;
+    cell.row = rowIdx;
+    cell.col = static_cast<qint8>(colIdx);
+    cell.value = static_cast<qint8>(value);
+    cell.reserved = 0;
+
+    send(BusOp::Cells, QByteArray(reinterpret_cast<const char*>(&cell), sizeof(cell)));
+}
+
+void EditBus::publishRange(int firstRow, int count)
+{
+    BusRange range;
+    range.firstRow = firstRow;
+    range.count = count;
+
+    QByteArray payload(reinterpret_cast<const char*>(&range), sizeof(range));
+    payload.append(reinterpret_cast<const char*>(m_pFile->getData().constData() + firstRow), count * sizeof(TtkFrame));
+
+    send(BusOp::Range, payload);
+}
+
+void EditBus::publishRecenter(Centering centering)
+{
+    quint32 value = static_cast<quint32>(centering);
+    send(BusOp::Recenter, QByteArray(reinterpret_cast<const char*>(&value), sizeof(value)));
+}
+
+void EditBus::publishWritten(quint64 contentHash)
+{
+    // Only the host writes the file
+    if (m_pHost == nullptr)
+        send(BusOp::Written, QByteArray(reinterpret_cast<const char*>(&contentHash), sizeof(contentHash)));
+}
+
+void EditBus::publishReloaded(quint64 contentHash)
+{
+    if (m_pHost == nullptr)
+        send(BusOp::Reloaded, QByteArray(reinterpret_cast<const char*>(&contentHash), sizeof(contentHash)));
+}
+
+void EditBus::onReadyRead(QLocalSocket* pSocket)
+{
+    // Applying a message can end in a resync that detaches the bus and drops m_pending,
+    // so work on a copy and only put what is left back while the socket is still ours
+    QByteArray buffer = m_pending.take(pSocket);
+    buffer.append(pSocket->readAll());
+
+    bool bFromHost = pSocket == m_pHost;
+    bool bApplied = false;
+    int offset = 0;
+
+    while (buffer.size() - offset >= static_cast<int>(sizeof(BusHeader)))
+    {
+        BusHeader header;
+        memcpy(&header, buffer.constData() + offset, sizeof(header));
+
+        if (memcmp(header.magic, BUS_MAGIC, sizeof(header.magic)) != 0 || header.version != BUS_VERSION || header.payloadSize > BUS_MAX_PAYLOAD)
+        {
+            // Not a compatible instance; drop it (and lose the host, if it was the host)
+            pSocket->disconnectFromServer();
+            return;
+        }
+
+        int size = sizeof(BusHeader) + header.payloadSize;
+        if (buffer.size() - offset < size)
+            break;
+
+        QByteArray message = buffer.mid(offset, size);
+        offset += size;
+
+        if (header.op == BUS_OP_WELCOME)
+        {
+            m_lastSeq = header.seq;
+            continue;
+        }
+
+        if (bFromHost)
+        {
+            bool bMissed = header.seq != m_lastSeq + 1;
+            m_lastSeq = header.seq;
+
+            if (!applyMessage(message) || bMissed)
+                emit resyncNeeded();
+
+            if (pSocket != m_pHost)
+                return;
+        }
+        else
+        {
+            // The host drops operations it can't apply, so nobody else sees them either
+            if (!applyMessage(message))
+                continue;
+
+            // Number the operation and pass it on to everyone, its sender included
+            header.seq = m_nextSeq++;
+            memcpy(message.data(), &header, sizeof(header));
+            broadcast(message);
+        }
+
+        bApplied = true;
+    }
+
+    if (pSocket == m_pHost || m_peers.contains(pSocket))
+        m_pending[pSocket] = buffer.mid(offset);
+
+    if (bApplied)
+        emit remoteChangesApplied();
+}
+
+bool EditBus::applyMessage(const QByteArray& message)
+{
+    BusHeader header;
+    memcpy(&header, message.constData(), sizeof(header));
+    QByteArray payload = message.mid(sizeof(BusHeader));
+
+    switch (static_cast<BusOp>(header.op))
+    {
+    case BusOp::Cells:
+        return applyCells(payload);
+    case BusOp::Range:
+        return applyRange(payload);
+    case BusOp::Recenter:
+    {
+        quint32 value;
+        if (payload.size() != sizeof(value))
+            return false;
+
+        memcpy(&value, payload.constData(), sizeof(value));
+        if (value != static_cast<quint32>(Centering::Seven) && value != static_cast<quint32>(Centering::Zero))
+            return false;
+
+        emit recenterReceived(static_cast<Centering>(value));
+        return true;
+    }
+    case BusOp::Written:
+    case BusOp::Reloaded:
+        return applyDiskState(static_cast<BusOp>(header.op), payload);
+    }
+
+    return false;
+}
+
+bool EditBus::applyCells(const QByteArray& payload)
+{
+    if (payload.size() % sizeof(BusCell) != 0)
+        return false;
+
+    const BusCell* pCells = reinterpret_cast<const BusCell*>(payload.constData());
+    int count = payload.size() / sizeof(BusCell);
+    int frameCount = m_pFile->getData().count();
+    int firstRow = frameCount;
+    int lastRow = -1;
+
+    // All or nothing: a batch applied in part would leave this instance out of step with the rest
+    for (int i = 0; i < count; i++)
+    {
+        const BusCell& cell = pCells[i];
+
+        if (cell.row < 0 || cell.row >= frameCount || cell.col < 0 || cell.col >= NUM_INPUT_COLUMNS
+            || !valueInRange(cell.col, cell.value, m_pFile->getCentering()))
+            return false;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const BusCell& cell = pCells[i];
+
+        m_pFile->setCellNumber(cell.row, cell.col, cell.value);
+        firstRow = qMin(firstRow, static_cast<int>(cell.row));
+        lastRow = qMax(lastRow, static_cast<int>(cell.row));
+    }
+
+    if (lastRow >= 0)
+    {
+        QAbstractItemModel* pModel = m_pFile->getTableView()->model();
+        emit pModel->dataChanged(pModel->index(firstRow, FRAMECOUNT_COLUMN), pModel->index(lastRow, NUM_INPUT_COLUMNS));
+    }
+
+    return true;
+}
+
+bool EditBus::applyRange(const QByteArray& payload)
+{
+    if (payload.size() < static_cast<int>(sizeof(BusRange)))
+        return false;
+
+    BusRange range;
+    memcpy(&range, payload.constData(), sizeof(range));
+
+    if (range.firstRow < 0 || range.count <= 0 || static_cast<qint64>(range.firstRow) + range.count > m_pFile->getData().count()
+        || payload.size() != static_cast<int>(sizeof(BusRange) + range.count * sizeof(TtkFrame)))
+        return false;
+
+    const TtkFrame* pFrames = reinterpret_cast<const TtkFrame*>(payload.constData() + sizeof(BusRange));
+    const TtkFileData& data = m_pFile->getData();
+    QVector<CellEditAction> edits;
+
+    for (int i = 0; i < range.count; i++)
+    {
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            int value = pFrames[i].values[col];
+
+            if (!valueInRange(col, value, m_pFile->getCentering()))
+                return false;
+
+            if (value != data[range.firstRow + i].values[col])
+                edits.append(CellEditAction(range.firstRow + i, col, data[range.firstRow + i].values[col], value, false));
+        }
+    }
+
+    if (edits.isEmpty())
+        return true;
+
+    m_pFile->applyEdits(edits);
+
+    QAbstractItemModel* pModel = m_pFile->getTableView()->model();
+    emit pModel->dataChanged(pModel->index(range.firstRow, FRAMECOUNT_COLUMN), pModel->index(range.firstRow + range.count - 1, NUM_INPUT_COLUMNS));
+
+    return true;
+}
+
+bool EditBus::applyDiskState(BusOp op, const QByteArray& payload)
+{
+    // Only the host writes or reloads for everyone, so the host drops these from anyone else
+    quint64 hash;
+    if (m_pHost == nullptr || payload.size() != sizeof(hash))
+        return false;
+
+    memcpy(&hash, payload.constData(), sizeof(hash));
+    m_hostDiskHash = hash;
+
+    // The host picked up a change from outside the bus; follow it unless that was already done here
+    if (op == BusOp::Reloaded && m_pFile->getContentHash() != hash)
+        emit resyncNeeded();
+
+    return true;
+}
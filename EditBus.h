@@ -0,0 +1,88 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class CellEditAction;
+class InputFile;
+class QLocalServer;
+class QLocalSocket;
+
+enum class BusOp : quint8
+{
+    Cells = 1,
+    Range,
+    Recenter,
+    Written,
+    Reloaded,
+};
+
+// Shares the edits of one file between editor instances on this machine over a local socket
+// named after the file's path. The first instance to open the file hosts the bus and is the
+// only one that writes the file; later instances join it. Every edit is sent to the host, which
+// numbers it, applies it and broadcasts it to all instances, so everyone applies the same
+// operations in the same order. An instance applies its own edits right away and again when the
+// host echoes them, which keeps concurrent edits to one cell converging on the host's order.
+// If the host goes away the others race to take over, reloading the file from disk. The host
+// announces the content hash of everything it writes and of any outside change it reloads, so
+// the others can tell its saves from changes they still have to pick up.
+class EditBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditBus(InputFile* pInputFile, QObject* parent = nullptr);
+    ~EditBus();
+
+    void attach();
+    void detach();
+    inline bool isAttached() const { return m_serverName != ""; }
+
+    // True when another instance hosts the bus and so owns writing the file
+    inline bool hasRemoteWriter() const { return m_pHost != nullptr; }
+
+    // What the host last said is on disk
+    inline quint64 hostDiskHash() const { return m_hostDiskHash; }
+
+    void publishCells(const QVector<CellEditAction>& edits);
+    void publishCell(int rowIdx, int colIdx, int value);
+    void publishRange(int firstRow, int count);
+    void publishRecenter(Centering centering);
+    void publishWritten(quint64 contentHash);
+    void publishReloaded(quint64 contentHash);
+
+signals:
+    // Remote operations from one read were applied to the file; the writer should save it
+    void remoteChangesApplied();
+    void recenterReceived(Centering centering);
+
+    // Operations may have been missed (the host changed or a sequence number was skipped)
+    void resyncNeeded();
+
+private:
+    InputFile* m_pFile;
+    QString m_serverName;
+    QLocalServer* m_pServer;
+    QLocalSocket* m_pHost;
+    QList<QLocalSocket*> m_peers;
+    QHash<QLocalSocket*, QByteArray> m_pending;
+    quint32 m_senderId;
+    quint32 m_nextSeq;
+    quint32 m_lastSeq;
+    quint64 m_hostDiskHash;
+
+    bool becomeHost();
+    void onNewConnection();
+    void onHostLost();
+    void onReadyRead(QLocalSocket* pSocket);
+    void send(BusOp op, const QByteArray& payload);
+    void broadcast(const QByteArray& message);
+    bool applyMessage(const QByteArray& message);
+    bool applyCells(const QByteArray& payload);
+    bool applyRange(const QByteArray& payload);
+    bool applyDiskState(BusOp op, const QByteArray& payload);
+};
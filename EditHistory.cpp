@@ -0,0 +1,256 @@
+#include "EditHistory.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+#define INVALID_IDX -1
+#define HISTORY_MAGIC "TTKH"
+#define HISTORY_VERSION 1
+#define HISTORY_EXTENSION ".ttkhist"
+
+struct HistoryHeader
+{
+    char magic[4];
+    quint32 version;
+    quint64 contentHash;
+    quint32 undoCount;
+    quint32 redoCount;
+};
+
+static_assert(sizeof(HistoryHeader) == 24, "HistoryHeader must stay packed for the sidecar format");
+
+CellEditAction::CellEditAction()
+    : m_rowIdx(INVALID_IDX)
+    , m_colIdx(INVALID_IDX)
+    , m_prev(0)
+    , m_cur(0)
+    , m_bLinked(false)
+{
+}
+
+CellEditAction::CellEditAction(int row, int col, QString prev, QString cur)
+    : CellEditAction(row, col, prev.toInt(), cur.toInt(), false)
+{
+}
+
+CellEditAction::CellEditAction(int row, int col, int prev, int cur, bool bLinked)
+    : m_rowIdx(row)
+    , m_colIdx(static_cast<qint8>(col))
+    , m_prev(static_cast<qint8>(prev))
+    , m_cur(static_cast<qint8>(cur))
+    , m_bLinked(bLinked)
+{
+}
+
+bool CellEditAction::operator==(const CellEditAction& rhs)
+{
+    return m_rowIdx == rhs.m_rowIdx && m_colIdx == rhs.m_colIdx && m_cur == rhs.m_cur;
+}
+
+static HistoryRecord toRecord(const CellEditAction& action)
+{
+    HistoryRecord record;
+    record.row = action.row();
+    record.col = static_cast<qint8>(action.col());
+    record.prev = static_cast<qint8>(action.prevNumber());
+    record.cur = static_cast<qint8>(action.curNumber());
+    record.flags = action.isLinked() ? HISTORY_FLAG_LINKED : 0;
+    return record;
+}
+
+static CellEditAction fromRecord(const HistoryRecord& record)
+{
+    return CellEditAction(record.row, record.col, record.prev, record.cur, (record.flags & HISTORY_FLAG_LINKED) != 0);
+}
+
+TtkStack::TtkStack()
+    : m_pMapped(nullptr)
+    , m_mappedCount(0)
+{
+}
+
+void TtkStack::push(const CellEditAction& action)
+{
+    m_actions.append(action);
+}
+
+CellEditAction TtkStack::pop()
+{
+    if (!m_actions.isEmpty())
+        return m_actions.takeLast();
+
+    m_mappedCount--;
+    return fromRecord(m_pMapped[m_mappedCount]);
+}
+
+CellEditAction TtkStack::top() const
+{
+    if (!m_actions.isEmpty())
+        return m_actions.last();
+
+    return fromRecord(m_pMapped[m_mappedCount - 1]);
+}
+
+CellEditAction TtkStack::at(int idx) const
+{
+    if (idx < m_mappedCount)
+        return fromRecord(m_pMapped[idx]);
+
+    return m_actions[idx - m_mappedCount];
+}
+
+void TtkStack::moveTopGroup(TtkStack* pDst, QVector<CellEditAction>* pMoved)
+{
+    // The group lands on the other stack in reverse order, so the links are recomputed:
+    // the first action moved starts the group there
+    int firstMoved = pMoved->count();
+    bool bLinked;
+
+    do
+    {
+        CellEditAction action = pop();
+        bLinked = action.isLinked();
+        action.flipValues();
+        action.setLinked(pMoved->count() > firstMoved);
+        pMoved->append(action);
+        pDst->push(action);
+    } while (bLinked && !isEmpty());
+}
+
+void TtkStack::clear()
+{
+    m_pMapped = nullptr;
+    m_mappedCount = 0;
+    m_actions.clear();
+}
+
+void TtkStack::setMappedBase(const HistoryRecord* pRecords, int count)
+{
+    m_pMapped = pRecords;
+    m_mappedCount = count;
+    m_actions.clear();
+}
+
+void TtkStack::appendRecords(QByteArray* pOut) const
+{
+    // Records that are still mapped are already in their final form
+    pOut->append(reinterpret_cast<const char*>(m_pMapped), m_mappedCount * sizeof(HistoryRecord));
+
+    for (int i = 0; i < m_actions.count(); i++)
+    {
+        HistoryRecord record = toRecord(m_actions[i]);
+        pOut->append(reinterpret_cast<const char*>(&record), sizeof(HistoryRecord));
+    }
+}
+
+HistorySidecar::HistorySidecar()
+    : m_pFile(nullptr)
+    , m_pData(nullptr)
+{
+}
+
+HistorySidecar::~HistorySidecar()
+{
+    unmap();
+}
+
+QString HistorySidecar::pathFor(const QString& filePath)
+{
+    return filePath + HISTORY_EXTENSION;
+}
+
+bool HistorySidecar::map(const QString& filePath, quint64 contentHash, TtkStack* pUndoStack, TtkStack* pRedoStack)
+{
+    unmap();
+
+    QString sidecarPath = pathFor(filePath);
+    if (!QFile::exists(sidecarPath))
+        return false;
+
+    m_pFile = new QFile(sidecarPath);
+    qint64 size = m_pFile->open(QIODevice::ReadOnly) ? m_pFile->size() : 0;
+
+    if (size >= static_cast<qint64>(sizeof(HistoryHeader)))
+        m_pData = m_pFile->map(0, size);
+
+    if (m_pData == nullptr)
+    {
+        unmap();
+        return false;
+    }
+
+    const HistoryHeader* pHeader = reinterpret_cast<const HistoryHeader*>(m_pData);
+    qint64 recordCount = static_cast<qint64>(pHeader->undoCount) + pHeader->redoCount;
+
+    bool bValid = memcmp(pHeader->magic, HISTORY_MAGIC, sizeof(pHeader->magic)) == 0
+        && pHeader->version == HISTORY_VERSION
+        && pHeader->contentHash == contentHash
+        && size == static_cast<qint64>(sizeof(HistoryHeader)) + recordCount * static_cast<qint64>(sizeof(HistoryRecord));
+
+    // The file was modified outside of this program, so the history no longer applies to it
+    if (!bValid)
+    {
+        unmap();
+        QFile::remove(sidecarPath);
+        return false;
+    }
+
+    const HistoryRecord* pRecords = reinterpret_cast<const HistoryRecord*>(m_pData + sizeof(HistoryHeader));
+    pUndoStack->setMappedBase(pRecords, pHeader->undoCount);
+    pRedoStack->setMappedBase(pRecords + pHeader->undoCount, pHeader->redoCount);
+
+    return true;
+}
+
+bool HistorySidecar::save(const QString& filePath, quint64 contentHash, TtkStack* pUndoStack, TtkStack* pRedoStack)
+{
+    QString sidecarPath = pathFor(filePath);
+
+    if (pUndoStack->isEmpty() && pRedoStack->isEmpty())
+    {
+        unmap();
+        QFile::remove(sidecarPath);
+        return true;
+    }
+
+    HistoryHeader header;
+    memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+    header.version = HISTORY_VERSION;
+    header.contentHash = contentHash;
+    header.undoCount = pUndoStack->count();
+    header.redoCount = pRedoStack->count();
+
+    QByteArray buffer;
+    buffer.reserve(sizeof(HistoryHeader) + (header.undoCount + header.redoCount) * sizeof(HistoryRecord));
+    buffer.append(reinterpret_cast<const char*>(&header), sizeof(HistoryHeader));
+    pUndoStack->appendRecords(&buffer);
+    pRedoStack->appendRecords(&buffer);
+
+    // The stacks may still point into the old mapping, which has to be released
+    // before the sidecar can be replaced
+    pUndoStack->clear();
+    pRedoStack->clear();
+    unmap();
+
+    QSaveFile fp(sidecarPath);
+    if (!fp.open(QIODevice::WriteOnly))
+        return false;
+
+    fp.write(buffer);
+    return fp.commit();
+}
+
+void HistorySidecar::unmap()
+{
+    if (m_pFile == nullptr)
+        return;
+
+    if (m_pData != nullptr)
+        m_pFile->unmap(m_pData);
+
+    delete m_pFile;
+    m_pFile = nullptr;
+    m_pData = nullptr;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+class QFile;
+
+// A linked action belongs to the same undo step as the action below it on its stack,
+// so a multi-cell edit is undone and redone as one transaction.
+class CellEditAction
+{
+public:
+    CellEditAction();
+    CellEditAction(int row, int col, QString prev, QString cur);
+    CellEditAction(int row, int col, int prev, int cur, bool bLinked);
+
+    bool operator==(const CellEditAction& rhs);
+    inline void flipValues()
+    {
+        qint8 temp = m_cur;
+        m_cur = m_prev;
+        m_prev = temp;
+    }
+    inline int row() const { return m_rowIdx; }
+    inline int col() const { return m_colIdx; }
+    inline QString curVal() const { return QString::number(m_cur); }
+    inline QString prevVal() const { return QString::number(m_prev); }
+    inline int curNumber() const { return m_cur; }
+    inline int prevNumber() const { return m_prev; }
+    inline bool isLinked() const { return m_bLinked; }
+    inline void setLinked(bool bLinked) { m_bLinked = bLinked; }
+
+private:
+    qint32 m_rowIdx;
+    qint8 m_colIdx;
+    qint8 m_prev;
+    qint8 m_cur;
+    bool m_bLinked;
+};
+
+// On-disk form of a CellEditAction. Every cell holds a small integer, so the
+// values are stored as bytes instead of strings.
+struct HistoryRecord
+{
+    qint32 row;
+    qint8 col;
+    qint8 prev;
+    qint8 cur;
+    quint8 flags;
+};
+
+#define HISTORY_FLAG_LINKED 0x01
+
+static_assert(sizeof(HistoryRecord) == 8, "HistoryRecord must stay packed for the sidecar format");
+
+// Undo/redo stack whose bottom part may live in a memory-mapped history sidecar.
+// Mapped records are only decoded when they are actually popped or inspected.
+class TtkStack
+{
+public:
+    TtkStack();
+
+    inline int count() const { return m_mappedCount + m_actions.count(); }
+    inline bool isEmpty() const { return count() == 0; }
+    void push(const CellEditAction& action);
+    CellEditAction pop();
+    CellEditAction top() const;
+    CellEditAction at(int idx) const;
+    void clear();
+
+    // Pops the top transaction onto pDst the way undo and redo do, appending what moved to pMoved
+    void moveTopGroup(TtkStack* pDst, QVector<CellEditAction>* pMoved);
+
+    void setMappedBase(const HistoryRecord* pRecords, int count);
+    void appendRecords(QByteArray* pOut) const;
+
+private:
+    const HistoryRecord* m_pMapped;
+    int m_mappedCount;
+    QVector<CellEditAction> m_actions;
+};
+
+// Persists the undo and redo stacks of a file to "<file>.ttkhist" and maps them back on reopen.
+// The sidecar records the content hash of the file it belongs to, so it is dropped if the file
+// was changed by something other than this program in the meantime.
+class HistorySidecar
+{
+public:
+    HistorySidecar();
+    ~HistorySidecar();
+
+    static QString pathFor(const QString& filePath);
+
+    bool map(const QString& filePath, quint64 contentHash, TtkStack* pUndoStack, TtkStack* pRedoStack);
+    bool save(const QString& filePath, quint64 contentHash, TtkStack* pUndoStack, TtkStack* pRedoStack);
+    void unmap();
+
+private:
+    QFile* m_pFile;
+    uchar* m_pData;
+};
@@ -0,0 +1,185 @@
+#include "EditMacro.h"
+
+#include <QByteArray>
+#include <QSettings>
+
+#include <algorithm>
+#include <cstring>
+
+#define MACRO_MAGIC "TTKM"
+#define MACRO_VERSION 1
+#define MACRO_SETTINGS_GROUP "macros"
+#define SETTINGS_ORGANIZATION "TASToolKit"
+#define SETTINGS_APPLICATION "TTKEditor"
+
+// Bounds for stored macros, far beyond anything recorded from a real file
+#define MAX_MACRO_STEPS 0x100000
+#define MAX_MACRO_SPAN 0x1000000
+
+struct MacroHeader
+{
+    char magic[4];
+    quint16 version;
+    quint8 centering;
+    quint8 reserved;
+    quint32 stepCount;
+};
+
+static_assert(sizeof(MacroHeader) == 12, "MacroHeader must stay packed for the stored macro format");
+
+EditMacro::EditMacro()
+    : m_centering(Centering::Unknown)
+{
+}
+
+void EditMacro::clear()
+{
+    m_steps.clear();
+    m_centering = Centering::Unknown;
+}
+
+void EditMacro::recordEdit(int row, int col, int value)
+{
+    // Editing the same cell again while recording just changes what the macro sets it to
+    for (MacroStep& step : m_steps)
+    {
+        if (step.rowOffset == row && step.col == col)
+        {
+            step.value = static_cast<qint8>(value);
+            return;
+        }
+    }
+
+    MacroStep step;
+    step.rowOffset = row;
+    step.col = static_cast<qint8>(col);
+    step.value = static_cast<qint8>(value);
+    step.reserved = 0;
+    m_steps.append(step);
+}
+
+void EditMacro::finishRecording(Centering centering)
+{
+    m_centering = centering;
+
+    if (m_steps.isEmpty())
+        return;
+
+    std::stable_sort(m_steps.begin(), m_steps.end(), [](const MacroStep& lhs, const MacroStep& rhs) { return lhs.rowOffset < rhs.rowOffset; });
+
+    int firstRow = m_steps.first().rowOffset;
+    for (MacroStep& step : m_steps)
+        step.rowOffset -= firstRow;
+}
+
+int EditMacro::span() const
+{
+    return m_steps.isEmpty() ? 0 : m_steps.last().rowOffset + 1;
+}
+
+bool EditMacro::apply(TtkFrame* pFrames, int firstRow, int count, int startRow, int interval, Centering centering, QString* pError) const
+{
+    int stickShift = 0;
+    if (m_centering == Centering::Seven && centering == Centering::Zero)
+        stickShift = -7;
+    else if (m_centering == Centering::Zero && centering == Centering::Seven)
+        stickShift = 7;
+
+    int lastRow = firstRow + count - 1;
+
+    for (int base = startRow; base + span() - 1 <= lastRow; base += interval)
+    {
+        for (const MacroStep& step : m_steps)
+        {
+            int value = step.value + (isStickColumn(step.col) ? stickShift : 0);
+
+            if (!valueInRange(step.col, value, centering))
+            {
+                *pError = QString("Frame %1: the macro would set a value of %2, which is outside the allowed range.")
+                    .arg(base + step.rowOffset + 1).arg(value);
+                return false;
+            }
+
+            qint64 row = static_cast<qint64>(base) + step.rowOffset;
+            if (row < firstRow || row > lastRow)
+            {
+                *pError = QString("Frame %1: the macro would edit a frame outside the selection.").arg(row + 1);
+                return false;
+            }
+
+            pFrames[row - firstRow].values[step.col] = static_cast<qint8>(value);
+        }
+
+        if (interval <= 0)
+            break;
+    }
+
+    return true;
+}
+
+QStringList EditMacro::savedNames()
+{
+    QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+    settings.beginGroup(MACRO_SETTINGS_GROUP);
+    return settings.childKeys();
+}
+
+bool EditMacro::load(const QString& name, EditMacro* pMacro)
+{
+    QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+    QByteArray bytes = settings.value(QString(MACRO_SETTINGS_GROUP) + "/" + name).toByteArray();
+
+    if (bytes.size() < static_cast<int>(sizeof(MacroHeader)))
+        return false;
+
+    MacroHeader header;
+    memcpy(&header, bytes.constData(), sizeof(MacroHeader));
+
+    if (memcmp(header.magic, MACRO_MAGIC, sizeof(header.magic)) != 0
+        || header.version != MACRO_VERSION
+        || header.centering > static_cast<quint8>(Centering::Zero)
+        || header.stepCount > MAX_MACRO_STEPS
+        || bytes.size() != static_cast<qint64>(sizeof(MacroHeader)) + static_cast<qint64>(header.stepCount) * static_cast<qint64>(sizeof(MacroStep)))
+        return false;
+
+    QVector<MacroStep> steps(static_cast<int>(header.stepCount));
+    memcpy(steps.data(), bytes.constData() + sizeof(MacroHeader), header.stepCount * sizeof(MacroStep));
+
+    // span() and apply() rely on steps being in range and sorted by frame, as finishRecording() leaves them
+    for (int i = 0; i < steps.count(); i++)
+    {
+        const MacroStep& step = steps[i];
+
+        if (step.col < 0 || step.col >= NUM_INPUT_COLUMNS
+            || step.rowOffset < 0 || step.rowOffset >= MAX_MACRO_SPAN
+            || (i > 0 && step.rowOffset < steps[i - 1].rowOffset))
+            return false;
+    }
+
+    pMacro->m_centering = static_cast<Centering>(header.centering);
+    pMacro->m_steps = steps;
+
+    return true;
+}
+
+void EditMacro::save(const QString& name) const
+{
+    MacroHeader header;
+    memcpy(header.magic, MACRO_MAGIC, sizeof(header.magic));
+    header.version = MACRO_VERSION;
+    header.centering = static_cast<quint8>(m_centering);
+    header.reserved = 0;
+    header.stepCount = m_steps.count();
+
+    QByteArray bytes(reinterpret_cast<const char*>(&header), sizeof(MacroHeader));
+    bytes.append(reinterpret_cast<const char*>(m_steps.constData()), m_steps.count() * sizeof(MacroStep));
+
+    QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+    settings.setValue(QString(MACRO_SETTINGS_GROUP) + "/" + name, bytes);
+}
+
+void EditMacro::remove(const QString& name)
+{
+    QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+    settings.remove(QString(MACRO_SETTINGS_GROUP) + "/" + name);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QString>
+#include <QStringList>
+
+// One recorded cell edit, relative to the earliest frame the macro touches
+struct MacroStep
+{
+    qint32 rowOffset;
+    qint8 col;
+    qint8 value;
+    quint16 reserved;
+};
+
+static_assert(sizeof(MacroStep) == 8, "MacroStep must stay packed for the stored macro format");
+
+// A sequence of cell edits recorded from the table and replayable at any frame. Stick
+// values are stored as recorded together with the file's centering, and shifted on
+// replay into a file with the other centering. Macros are kept in the user's settings.
+class EditMacro
+{
+public:
+    EditMacro();
+
+    void clear();
+    inline bool isEmpty() const { return m_steps.isEmpty(); }
+
+    // While recording, rows are absolute; finishRecording() makes them relative
+    void recordEdit(int row, int col, int value);
+    void finishRecording(Centering centering);
+
+    // Number of frames from the first edited frame to the last
+    int span() const;
+
+    // Applies the macro to frames[0..count) (file rows firstRow onward) starting at startRow,
+    // and again every interval frames while it still fits. Interval 0 plays it once.
+    bool apply(TtkFrame* pFrames, int firstRow, int count, int startRow, int interval, Centering centering, QString* pError) const;
+
+    static QStringList savedNames();
+    static bool load(const QString& name, EditMacro* pMacro);
+    void save(const QString& name) const;
+    static void remove(const QString& name);
+
+private:
+    QVector<MacroStep> m_steps;
+    Centering m_centering;
+};
@@ -0,0 +1,107 @@
+#include "FileWatchService.h"
+
+#include "Trace.h"
+
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#define RELOAD_DEBOUNCE_MS 150
+#define RELOAD_MAX_DEFER_MS 500
+
+// How long to wait for a replaced file to reappear before polling for it more slowly
+#define MAX_MISSING_RETRIES 10
+#define MISSING_POLL_MS 1000
+
+FileWatchService::FileWatchService(QObject* parent)
+    : QObject(parent)
+    , m_pWatcher(new QFileSystemWatcher(this))
+    , m_stats{ 0, 0, 0, 0, 0 }
+{
+    connect(m_pWatcher, &QFileSystemWatcher::fileChanged, this, &FileWatchService::onFileChanged);
+}
+
+void FileWatchService::watch(const QString& path)
+{
+    if (m_watches.contains(path))
+        return;
+
+    Watch watch;
+    watch.pDebounce = new QTimer(this);
+    watch.pDebounce->setSingleShot(true);
+    watch.pDebounce->setInterval(RELOAD_DEBOUNCE_MS);
+    watch.missingRetries = 0;
+    connect(watch.pDebounce, &QTimer::timeout, this, [this, path]() { onDebounced(path); });
+
+    m_watches.insert(path, watch);
+    m_pWatcher->addPath(path);
+}
+
+void FileWatchService::unwatch(const QString& path)
+{
+    if (!m_watches.contains(path))
+        return;
+
+    // Unwatching can happen from inside reloadDue, i.e. while this timer's timeout is still on the stack
+    QTimer* pDebounce = m_watches.take(path).pDebounce;
+    pDebounce->stop();
+    pDebounce->disconnect(this);
+    pDebounce->deleteLater();
+    m_pWatcher->removePath(path);
+}
+
+void FileWatchService::onFileChanged(const QString& path)
+{
+    if (!m_watches.contains(path))
+        return;
+
+    Watch& watch = m_watches[path];
+    m_stats.changeEvents++;
+
+    if (!watch.pDebounce->isActive())
+    {
+        watch.burstStart.start();
+        watch.missingRetries = 0;
+        watch.pDebounce->start();
+    }
+    else if (watch.burstStart.elapsed() < RELOAD_MAX_DEFER_MS)
+    {
+        // A file that never goes quiet (a live recording) still reloads every so often
+        watch.pDebounce->start();
+    }
+}
+
+void FileWatchService::onDebounced(const QString& path)
+{
+    Watch& watch = m_watches[path];
+
+    // A rename-over writer removes the old file before the new one lands
+    // (a slow save can take a while), and the watcher has dropped the path by then. Keep
+    // looking until it is back so the document stays watched.
+    if (!QFile::exists(path))
+    {
+        if (++watch.missingRetries > MAX_MISSING_RETRIES)
+            watch.pDebounce->setInterval(MISSING_POLL_MS);
+
+        watch.pDebounce->start();
+        return;
+    }
+
+    watch.pDebounce->setInterval(RELOAD_DEBOUNCE_MS);
+
+    if (!m_pWatcher->files().contains(path))
+        m_pWatcher->addPath(path);
+
+    QElapsedTimer burstStart = watch.burstStart;
+
+    {
+        TTK_TRACE_SCOPE("reloadDue");
+        emit reloadDue(path);
+    }
+
+    qint64 latencyMs = burstStart.elapsed();
+    m_stats.reloads++;
+    m_stats.lastLatencyMs = latencyMs;
+    m_stats.maxLatencyMs = qMax(m_stats.maxLatencyMs, latencyMs);
+    m_stats.totalLatencyMs += latencyMs;
+}
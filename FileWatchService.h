@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+
+class QFileSystemWatcher;
+class QTimer;
+
+struct ReloadStats
+{
+    int changeEvents;
+    int reloads;
+    qint64 lastLatencyMs;
+    qint64 maxLatencyMs;
+    qint64 totalLatencyMs;
+};
+
+// One QFileSystemWatcher shared by every open document. Bursts of change events for a path
+// (editors that write in several steps) are merged into a single reloadDue after the path
+// has been quiet for a short while. Writers that replace the file through a rename drop it
+// from the watcher, so the path is polled for and re-added once the new file exists.
+class FileWatchService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileWatchService(QObject* parent = nullptr);
+
+    void watch(const QString& path);
+    void unwatch(const QString& path);
+
+    inline const ReloadStats& getStats() const { return m_stats; }
+
+signals:
+    // Reload latency is measured until the connected slots return
+    void reloadDue(const QString& path);
+
+private:
+    struct Watch
+    {
+        QTimer* pDebounce;
+        QElapsedTimer burstStart;
+        int missingRetries;
+    };
+
+    void onFileChanged(const QString& path);
+    void onDebounced(const QString& path);
+
+    QFileSystemWatcher* m_pWatcher;
+    QHash<QString, Watch> m_watches;
+    ReloadStats m_stats;
+};
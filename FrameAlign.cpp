@@ -0,0 +1,274 @@
+#include "FrameAlign.h"
+
+#include <cmath>
+#include <complex>
+
+#define ALIGN_MIN_FRAMES 60
+#define ALIGN_SEGMENT_SEARCH 300
+#define ALIGN_MIN_SEGMENT_SCORE 0.2
+
+typedef std::complex<double> Complex;
+
+// Each input column as a zero-mean, unit-variance signal. Columns that never change are left out.
+struct AlignSignals
+{
+    QVector<double> channels[NUM_INPUT_COLUMNS];
+    bool bUsed[NUM_INPUT_COLUMNS];
+};
+
+static void buildSignals(const TtkFileData& data, Centering centering, AlignSignals* pSignals)
+{
+    int neutral = (centering == Centering::Seven) ? 7 : 0;
+
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+    {
+        QVector<double>& channel = pSignals->channels[col];
+        channel.resize(data.count());
+
+        double sum = 0;
+        for (int row = 0; row < data.count(); row++)
+        {
+            int value = data[row].values[col];
+
+            if (isStickColumn(col))
+                value -= neutral;
+            else if (TTK_COLUMNS[col].kind == ColumnKind::DPad)
+                value = (value != 0);
+
+            channel[row] = value;
+            sum += value;
+        }
+
+        double mean = sum / qMax(1, data.count());
+        double variance = 0;
+        for (double& value : channel)
+        {
+            value -= mean;
+            variance += value * value;
+        }
+
+        double deviation = std::sqrt(variance / qMax(1, data.count()));
+        pSignals->bUsed[col] = deviation > 1e-9;
+
+        if (pSignals->bUsed[col])
+        {
+            for (double& value : channel)
+                value /= deviation;
+        }
+    }
+}
+
+// In-place iterative radix-2 FFT; buffer.count() must be a power of two
+static void fft(QVector<Complex>& buffer, bool bInverse)
+{
+    int n = buffer.count();
+    Complex* pData = buffer.data();
+
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+            std::swap(pData[i], pData[j]);
+    }
+
+    const double pi = std::acos(-1.0);
+    QVector<Complex> twiddles(n / 2);
+    for (int i = 0; i < n / 2; i++)
+        twiddles[i] = std::polar(1.0, (bInverse ? 2 : -2) * pi * i / n);
+
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        int step = n / len;
+
+        for (int start = 0; start < n; start += len)
+        {
+            for (int k = 0; k < len / 2; k++)
+            {
+                Complex even = pData[start + k];
+                Complex odd = pData[start + k + len / 2] * twiddles[k * step];
+                pData[start + k] = even + odd;
+                pData[start + k + len / 2] = even - odd;
+            }
+        }
+    }
+}
+
+// Correlates a[firstA..firstA+countA) with b[firstB..firstB+countB), where lag k pairs a's t-th
+// sample with b's (t + k)-th. Only lags in minLag..maxLag overlapping by minOverlap samples are
+// considered. Each channel pair is packed into one complex FFT (a real, b imaginary) and the
+// spectra of all channels are summed before a single inverse FFT.
+static bool correlate(const AlignSignals& a, int firstA, int countA, const AlignSignals& b, int firstB, int countB,
+                      int minLag, int maxLag, int minOverlap, int* pBestLag, double* pBestScore)
+{
+    int n = 1;
+    while (n < countA + countB - 1)
+        n <<= 1;
+
+    QVector<Complex> spectrum(n, Complex(0, 0));
+    QVector<Complex> packed(n);
+    int numChannels = 0;
+
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+    {
+        if (!a.bUsed[col] || !b.bUsed[col])
+            continue;
+
+        numChannels++;
+        packed.fill(Complex(0, 0));
+
+        const double* pA = a.channels[col].constData() + firstA;
+        const double* pB = b.channels[col].constData() + firstB;
+
+        for (int i = 0; i < countA; i++)
+            packed[i].real(pA[i]);
+        for (int i = 0; i < countB; i++)
+            packed[i].imag(pB[i]);
+
+        fft(packed, false);
+
+        // Split the two real signals' spectra back out and accumulate conj(A) * B
+        for (int k = 0; k < n; k++)
+        {
+            Complex z = packed[k];
+            Complex zMirror = std::conj(packed[(n - k) % n]);
+            Complex spectrumA = (z + zMirror) * 0.5;
+            Complex spectrumB = (z - zMirror) * Complex(0, -0.5);
+            spectrum[k] += std::conj(spectrumA) * spectrumB;
+        }
+    }
+
+    if (numChannels == 0)
+        return false;
+
+    fft(spectrum, true);
+
+    minLag = qMax(minLag, -(countA - 1));
+    maxLag = qMin(maxLag, countB - 1);
+
+    bool bFound = false;
+
+    for (int lag = minLag; lag <= maxLag; lag++)
+    {
+        int overlap = qMin(countA, countB - lag) - qMax(0, -lag);
+        if (overlap < minOverlap)
+            continue;
+
+        double score = spectrum[(lag + n) % n].real() / n / overlap / numChannels;
+
+        if (!bFound || score > *pBestScore)
+        {
+            bFound = true;
+            *pBestLag = lag;
+            *pBestScore = score;
+        }
+    }
+
+    return bFound;
+}
+
+FrameAlign::FrameAlign()
+{
+    clear();
+}
+
+void FrameAlign::clear()
+{
+    m_bValid = false;
+    m_offset = 0;
+    m_score = 0;
+    m_segments.clear();
+}
+
+bool FrameAlign::align(const TtkFileData& player, Centering playerCentering, const TtkFileData& ghost, Centering ghostCentering, int segmentLength)
+{
+    clear();
+
+    if (player.count() < ALIGN_MIN_FRAMES || ghost.count() < ALIGN_MIN_FRAMES)
+        return false;
+
+    AlignSignals playerSignals, ghostSignals;
+    buildSignals(player, playerCentering, &playerSignals);
+    buildSignals(ghost, ghostCentering, &ghostSignals);
+
+    // Require half of the shorter file to overlap, so a few frames at the edges can't win on luck
+    int minOverlap = qMin(player.count(), ghost.count()) / 2;
+
+    if (!correlate(playerSignals, 0, player.count(), ghostSignals, 0, ghost.count(),
+                   -player.count(), ghost.count(), minOverlap, &m_offset, &m_score))
+        return false;
+
+    m_bValid = true;
+
+    if (segmentLength <= 0)
+        return true;
+
+    for (int segStart = 0; segStart < player.count(); segStart += segmentLength)
+    {
+        int segCount = qMin(segmentLength, player.count() - segStart);
+
+        // Search the ghost near where the whole-file offset puts this segment
+        int winStart = qBound(0, segStart + m_offset - ALIGN_SEGMENT_SEARCH, ghost.count() - 1);
+        int winEnd = qBound(0, segStart + m_offset + segCount + ALIGN_SEGMENT_SEARCH, ghost.count());
+
+        AlignSegment segment = { segStart, m_offset, m_score };
+        int lag;
+        double score;
+
+        // A segment with too little happening in it keeps the whole-file offset
+        if (winEnd - winStart >= segCount / 2
+            && correlate(playerSignals, segStart, segCount, ghostSignals, winStart, winEnd - winStart,
+                         segStart + m_offset - ALIGN_SEGMENT_SEARCH - winStart,
+                         segStart + m_offset + ALIGN_SEGMENT_SEARCH - winStart,
+                         segCount / 2, &lag, &score)
+            && score >= ALIGN_MIN_SEGMENT_SCORE)
+        {
+            segment.offset = winStart + lag - segStart;
+            segment.score = score;
+        }
+
+        if (!m_segments.isEmpty() && m_segments.last().offset == segment.offset)
+            m_segments.last().score = qMax(m_segments.last().score, segment.score);
+        else
+            m_segments.append(segment);
+    }
+
+    return true;
+}
+
+const AlignSegment* FrameAlign::segmentFor(int playerRow) const
+{
+    const AlignSegment* pSegment = nullptr;
+
+    for (const AlignSegment& segment : m_segments)
+    {
+        if (segment.firstRow > playerRow)
+            break;
+        pSegment = &segment;
+    }
+
+    return pSegment;
+}
+
+int FrameAlign::ghostRowFor(int playerRow) const
+{
+    const AlignSegment* pSegment = segmentFor(playerRow);
+    return playerRow + (pSegment ? pSegment->offset : m_offset);
+}
+
+int FrameAlign::playerRowFor(int ghostRow) const
+{
+    int offset = m_offset;
+
+    for (const AlignSegment& segment : m_segments)
+    {
+        if (segment.firstRow + segment.offset > ghostRow)
+            break;
+        offset = segment.offset;
+    }
+
+    return ghostRow - offset;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QVector>
+
+// A run of player frames starting at firstRow that lines up with ghost frames
+// firstRow + offset onwards. score is the mean correlation per frame and column of the
+// normalized signals: about 1 for an exact match, about 0 for unrelated inputs.
+struct AlignSegment
+{
+    int firstRow;
+    int offset;
+    double score;
+};
+
+// Finds the frame offset between two input files by cross-correlating their button and stick
+// signals. Every column becomes a zero-mean, unit-variance signal and the correlation at all lags
+// is computed at once with FFTs, so aligning two whole races costs a handful of FFTs over a few
+// tens of thousands of samples. With a segment length the player is also split into segments that
+// are each correlated against the ghost near the whole-file offset, for files that drift apart.
+class FrameAlign
+{
+public:
+    FrameAlign();
+
+    // Returns false if either file is too short or too flat to correlate
+    bool align(const TtkFileData& player, Centering playerCentering, const TtkFileData& ghost, Centering ghostCentering, int segmentLength = 0);
+    void clear();
+
+    inline bool isValid() const { return m_bValid; }
+    inline int getOffset() const { return m_offset; }
+    inline double getScore() const { return m_score; }
+    inline const QVector<AlignSegment>& getSegments() const { return m_segments; }
+
+    // The ghost row matching a player row, and back
+    int ghostRowFor(int playerRow) const;
+    int playerRowFor(int ghostRow) const;
+
+private:
+    bool m_bValid;
+    int m_offset;
+    double m_score;
+    QVector<AlignSegment> m_segments;
+
+    const AlignSegment* segmentFor(int playerRow) const;
+};
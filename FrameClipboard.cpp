@@ -0,0 +1,129 @@
+#include "FrameClipboard.h"
+
+#include "Trace.h"
+#include "TtkbFile.h"
+
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QMimeData>
+
+#include <cstring>
+
+void FrameClipboard::copy(const TtkFileData& data, const FrameRanges& frames, Centering centering)
+{
+    TTK_TRACE_SCOPE("copyFrames");
+
+    QByteArray csv;
+    for (const FrameRange& range : frames.ranges())
+        appendCsvLines(data.constData() + range.first, range.last - range.first + 1, &csv);
+
+    // A single range goes to .ttkb bytes in place; several are gathered into one block first
+    QByteArray ttkb;
+    if (frames.ranges().count() == 1)
+    {
+        ttkb = TtkbFile::toBytes(data.constData() + frames.firstFrame(), frames.frameCount(), centering);
+    }
+    else
+    {
+        TtkFileData block(frames.frameCount());
+        TtkFrame* pDst = block.data();
+
+        for (const FrameRange& range : frames.ranges())
+        {
+            int count = range.last - range.first + 1;
+            memcpy(pDst, data.constData() + range.first, count * sizeof(TtkFrame));
+            pDst += count;
+        }
+
+        ttkb = TtkbFile::toBytes(block.constData(), block.count(), centering);
+    }
+
+    QMimeData* pMime = new QMimeData();
+    pMime->setText(QString::fromLatin1(csv));
+    pMime->setData(TTKB_MIME_TYPE, ttkb);
+    QGuiApplication::clipboard()->setMimeData(pMime);
+}
+
+FileStatus FrameClipboard::paste(Centering centering, TtkFileData* pFrames, int* pErrorLine)
+{
+    TTK_TRACE_SCOPE("pasteFrames");
+
+    *pErrorLine = 0;
+
+    const QMimeData* pMime = QGuiApplication::clipboard()->mimeData();
+    if (pMime == nullptr)
+        return FileStatus::Parse;
+
+    if (!pMime->hasFormat(TTKB_MIME_TYPE))
+        return pMime->hasText() ? parseCsv(pMime->text(), centering, pFrames, pErrorLine) : FileStatus::Parse;
+
+    QByteArray bytes = pMime->data(TTKB_MIME_TYPE);
+    Centering sourceCentering = Centering::Unknown;
+
+    FileStatus status = TtkbFile::fromMemory(reinterpret_cast<const uchar*>(bytes.constData()), bytes.size(), pFrames, &sourceCentering);
+    if (status != FileStatus::Success)
+        return status;
+
+    int stickOffset = 0;
+    if (sourceCentering == Centering::Seven && centering == Centering::Zero)
+        stickOffset = -7;
+    else if (sourceCentering == Centering::Zero && centering == Centering::Seven)
+        stickOffset = 7;
+
+    for (int i = 0; i < pFrames->count(); i++)
+    {
+        TtkFrame& frame = (*pFrames)[i];
+
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            int value = frame.values[col] + (isStickColumn(col) ? stickOffset : 0);
+
+            if (!valueInRange(col, value, centering))
+            {
+                *pErrorLine = i + 1;
+                return FileStatus::Parse;
+            }
+
+            frame.values[col] = static_cast<qint8>(value);
+        }
+    }
+
+    return FileStatus::Success;
+}
+
+FileStatus FrameClipboard::parseCsv(const QString& text, Centering centering, TtkFileData* pFrames, int* pErrorLine)
+{
+    // One pass over the text, each line parsed where it lies. Blank lines (a trailing newline) are skipped.
+    CsvFrameParser parser(centering);
+    const QChar* pChars = text.constData();
+    int length = text.length();
+
+    pFrames->clear();
+
+    for (int lineStart = 0, lineNumber = 1; lineStart < length; lineNumber++)
+    {
+        int lineEnd = text.indexOf('\n', lineStart);
+        if (lineEnd < 0)
+            lineEnd = length;
+
+        int next = lineEnd + 1;
+        if (lineEnd > lineStart && pChars[lineEnd - 1] == '\r')
+            lineEnd--;
+
+        if (lineEnd > lineStart)
+        {
+            TtkFrame frame;
+            if (!parser.parseLine(pChars + lineStart, lineEnd - lineStart, &frame))
+            {
+                *pErrorLine = lineNumber;
+                return FileStatus::Parse;
+            }
+
+            pFrames->append(frame);
+        }
+
+        lineStart = next;
+    }
+
+    return FileStatus::Success;
+}
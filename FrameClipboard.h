@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FrameSelection.h"
+#include "TtkFrame.h"
+
+#define TTKB_MIME_TYPE "application/x-ttkb"
+
+// Blocks of frames on the system clipboard, as TTK CSV text for other programs and as .ttkb
+// bytes for this editor. Both are written straight from the frame storage, range by range.
+class FrameClipboard
+{
+public:
+    static void copy(const TtkFileData& data, const FrameRanges& frames, Centering centering);
+
+    // Reads the clipboard as frames for a file with the given centering. Frames copied from a
+    // file with the other centering have their sticks moved over. Every value is checked, and
+    // pErrorLine is set to the first bad frame (1-based) when one isn't valid.
+    static FileStatus paste(Centering centering, TtkFileData* pFrames, int* pErrorLine);
+
+private:
+    static FileStatus parseCsv(const QString& text, Centering centering, TtkFileData* pFrames, int* pErrorLine);
+};
@@ -0,0 +1,188 @@
+#include "FrameCodec.h"
+
+#include <climits>
+#include <cstring>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFF
+#define LZ_HASH_BITS 12
+#define LZ_RUN_MASK 15
+#define LZ_HEADER_BYTES 4
+
+static inline quint32 read32(const uchar* p)
+{
+    quint32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline int hash4(quint32 sequence)
+{
+    return static_cast<int>((sequence * 2654435761u) >> (32 - LZ_HASH_BITS));
+}
+
+// Lengths past the token's nibble continue in bytes of 255 ended by a smaller one
+static inline uchar* writeLength(uchar* pDst, int length)
+{
+    for (; length >= 255; length -= 255)
+        *pDst++ = 255;
+
+    *pDst++ = static_cast<uchar>(length);
+    return pDst;
+}
+
+static inline bool readLength(const uchar** ppSrc, const uchar* pEnd, int* pLength)
+{
+    const uchar* pSrc = *ppSrc;
+    uchar byte;
+
+    do
+    {
+        if (pSrc >= pEnd || *pLength > INT_MAX - 255)
+            return false;
+
+        byte = *pSrc++;
+        *pLength += byte;
+    } while (byte == 255);
+
+    *ppSrc = pSrc;
+    return true;
+}
+
+static uchar* writeSequence(uchar* pDst, const uchar* pLiterals, int literalCount, int offset, int matchLength)
+{
+    int matchCode = matchLength - LZ_MIN_MATCH;
+    uchar* pToken = pDst++;
+    *pToken = static_cast<uchar>(qMin(literalCount, LZ_RUN_MASK) << 4);
+
+    if (literalCount >= LZ_RUN_MASK)
+        pDst = writeLength(pDst, literalCount - LZ_RUN_MASK);
+
+    memcpy(pDst, pLiterals, literalCount);
+    pDst += literalCount;
+
+    // The last sequence is literals only; the stream ending after them marks it
+    if (matchLength == 0)
+        return pDst;
+
+    *pToken |= static_cast<uchar>(qMin(matchCode, LZ_RUN_MASK));
+    *pDst++ = static_cast<uchar>(offset);
+    *pDst++ = static_cast<uchar>(offset >> 8);
+
+    if (matchCode >= LZ_RUN_MASK)
+        pDst = writeLength(pDst, matchCode - LZ_RUN_MASK);
+
+    return pDst;
+}
+
+void compressFrames(const TtkFileData& frames, QByteArray* pOut)
+{
+    const uchar* pSrc = reinterpret_cast<const uchar*>(frames.constData());
+    int size = frames.count() * static_cast<int>(sizeof(TtkFrame));
+
+    // Incompressible input grows by a length byte per 255 literals plus a token
+    pOut->resize(LZ_HEADER_BYTES + size + size / 255 + 16);
+    uchar* pStart = reinterpret_cast<uchar*>(pOut->data());
+    uchar* pDst = pStart + LZ_HEADER_BYTES;
+
+    quint32 rawSize = static_cast<quint32>(size);
+    memcpy(pStart, &rawSize, sizeof(rawSize));
+
+    int table[1 << LZ_HASH_BITS];
+    for (int& pos : table)
+        pos = -1;
+
+    int anchor = 0;
+    int pos = 0;
+
+    while (pos + LZ_MIN_MATCH <= size)
+    {
+        quint32 sequence = read32(pSrc + pos);
+        int h = hash4(sequence);
+        int ref = table[h];
+        table[h] = pos;
+
+        if (ref < 0 || pos - ref > LZ_MAX_OFFSET || read32(pSrc + ref) != sequence)
+        {
+            pos++;
+            continue;
+        }
+
+        int length = LZ_MIN_MATCH;
+        while (pos + length < size && pSrc[ref + length] == pSrc[pos + length])
+            length++;
+
+        pDst = writeSequence(pDst, pSrc + anchor, pos - anchor, pos - ref, length);
+        pos += length;
+        anchor = pos;
+    }
+
+    pDst = writeSequence(pDst, pSrc + anchor, size - anchor, 0, 0);
+    pOut->resize(static_cast<int>(pDst - pStart));
+}
+
+bool decompressFrames(const QByteArray& packed, TtkFileData* pFrames)
+{
+    if (packed.size() < LZ_HEADER_BYTES)
+        return false;
+
+    quint32 rawSize;
+    memcpy(&rawSize, packed.constData(), sizeof(rawSize));
+
+    if (rawSize % sizeof(TtkFrame) != 0 || rawSize > static_cast<quint32>(INT_MAX))
+        return false;
+
+    const uchar* pSrc = reinterpret_cast<const uchar*>(packed.constData()) + LZ_HEADER_BYTES;
+    const uchar* pEnd = reinterpret_cast<const uchar*>(packed.constData()) + packed.size();
+    int size = static_cast<int>(rawSize);
+
+    pFrames->resize(size / static_cast<int>(sizeof(TtkFrame)));
+    uchar* pDst = reinterpret_cast<uchar*>(pFrames->data());
+    int out = 0;
+
+    while (pSrc < pEnd)
+    {
+        int token = *pSrc++;
+        int literalCount = token >> 4;
+
+        if (literalCount == LZ_RUN_MASK && !readLength(&pSrc, pEnd, &literalCount))
+            return false;
+        if (literalCount > pEnd - pSrc || literalCount > size - out)
+            return false;
+
+        memcpy(pDst + out, pSrc, literalCount);
+        pSrc += literalCount;
+        out += literalCount;
+
+        if (pSrc == pEnd)
+            break;
+
+        if (pEnd - pSrc < 2)
+            return false;
+
+        int offset = pSrc[0] | (pSrc[1] << 8);
+        pSrc += 2;
+
+        int length = token & LZ_RUN_MASK;
+        if (length == LZ_RUN_MASK && !readLength(&pSrc, pEnd, &length))
+            return false;
+        length += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > out || length > size - out)
+            return false;
+
+        // References usually overlap what they produce (a frame repeating the one before it).
+        // The output repeats every offset bytes, so each copy can reach back twice as far.
+        int distance = offset;
+        for (int copied = 0; copied < length; distance *= 2)
+        {
+            int chunk = qMin(distance, length - copied);
+            memcpy(pDst + out + copied, pDst + out + copied - distance, chunk);
+            copied += chunk;
+        }
+
+        out += length;
+    }
+
+    return out == size;
+}
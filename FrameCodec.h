@@ -0,0 +1,14 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QByteArray>
+
+// A small LZ77 codec for in-memory frame buffers, in the style of LZ4: runs of literal bytes
+// and back-references of at least 4 bytes up to 64 KB back, with no entropy coding. Held
+// inputs repeat the frame before them, so most of a race becomes a handful of references
+// six bytes back, and both directions run at memory speed.
+void compressFrames(const TtkFileData& frames, QByteArray* pOut);
+
+// Returns false if packed wasn't produced by compressFrames
+bool decompressFrames(const QByteArray& packed, TtkFileData* pFrames);
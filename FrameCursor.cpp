@@ -0,0 +1,145 @@
+#include "FrameCursor.h"
+
+#include <QTimer>
+
+#include <cstring>
+#include <new>
+
+#define FRAME_CURSOR_MAGIC "TTKF"
+#define FRAME_CURSOR_VERSION 1
+#define FRAME_CURSOR_POLL_MS 16
+
+// Retry attaching about once a second while no publisher is running
+#define FRAME_CURSOR_ATTACH_INTERVAL 60
+
+FrameCursorPublisher::FrameCursorPublisher()
+    : m_shm(FRAME_CURSOR_KEY)
+    , m_pRing(nullptr)
+{
+}
+
+bool FrameCursorPublisher::open()
+{
+    // A segment left behind by a crashed publisher is simply reused
+    if (!m_shm.create(sizeof(FrameCursorRing)) && !m_shm.attach())
+        return false;
+
+    m_pRing = new (m_shm.data()) FrameCursorRing();
+    memcpy(m_pRing->magic, FRAME_CURSOR_MAGIC, sizeof(m_pRing->magic));
+    m_pRing->version = FRAME_CURSOR_VERSION;
+    m_pRing->writeCount.store(0, std::memory_order_release);
+
+    return true;
+}
+
+void FrameCursorPublisher::publish(int playerFrame, int ghostFrame)
+{
+    if (m_pRing == nullptr)
+        return;
+
+    quint64 count = m_pRing->writeCount.load(std::memory_order_relaxed) + 1;
+    FrameCursorSample& sample = m_pRing->samples[count % FRAME_CURSOR_RING_SIZE];
+
+    sample.seq.store(2 * count - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    sample.playerFrame.store(playerFrame, std::memory_order_relaxed);
+    sample.ghostFrame.store(ghostFrame, std::memory_order_relaxed);
+    sample.seq.store(2 * count, std::memory_order_release);
+
+    m_pRing->writeCount.store(count, std::memory_order_release);
+}
+
+FrameCursorReader::FrameCursorReader(QObject* parent)
+    : QObject(parent)
+    , m_shm(FRAME_CURSOR_KEY)
+    , m_pRing(nullptr)
+    , m_pTimer(new QTimer(this))
+    , m_lastWriteCount(0)
+    , m_pollsUntilAttach(0)
+    , m_playerFrame(NO_CURSOR_FRAME)
+    , m_ghostFrame(NO_CURSOR_FRAME)
+{
+    m_pTimer->setInterval(FRAME_CURSOR_POLL_MS);
+    connect(m_pTimer, &QTimer::timeout, this, &FrameCursorReader::poll);
+}
+
+void FrameCursorReader::start()
+{
+    m_pollsUntilAttach = 0;
+    m_pTimer->start();
+}
+
+void FrameCursorReader::stop()
+{
+    m_pTimer->stop();
+
+    if (m_shm.isAttached())
+        m_shm.detach();
+
+    m_pRing = nullptr;
+    m_lastWriteCount = 0;
+    m_playerFrame = NO_CURSOR_FRAME;
+    m_ghostFrame = NO_CURSOR_FRAME;
+}
+
+bool FrameCursorReader::attach()
+{
+    if (!m_shm.attach(QSharedMemory::ReadOnly))
+        return false;
+
+    const FrameCursorRing* pRing = static_cast<const FrameCursorRing*>(m_shm.constData());
+
+    if (m_shm.size() < static_cast<int>(sizeof(FrameCursorRing))
+        || memcmp(pRing->magic, FRAME_CURSOR_MAGIC, sizeof(pRing->magic)) != 0
+        || pRing->version != FRAME_CURSOR_VERSION)
+    {
+        m_shm.detach();
+        return false;
+    }
+
+    m_pRing = pRing;
+    return true;
+}
+
+void FrameCursorReader::poll()
+{
+    if (m_pRing == nullptr)
+    {
+        if (m_pollsUntilAttach > 0)
+        {
+            m_pollsUntilAttach--;
+            return;
+        }
+
+        if (!attach())
+        {
+            m_pollsUntilAttach = FRAME_CURSOR_ATTACH_INTERVAL;
+            return;
+        }
+    }
+
+    quint64 count = m_pRing->writeCount.load(std::memory_order_acquire);
+    if (count == 0 || count == m_lastWriteCount)
+        return;
+
+    const FrameCursorSample& sample = m_pRing->samples[count % FRAME_CURSOR_RING_SIZE];
+
+    quint64 seqBefore = sample.seq.load(std::memory_order_acquire);
+    int playerFrame = sample.playerFrame.load(std::memory_order_relaxed);
+    int ghostFrame = sample.ghostFrame.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    quint64 seqAfter = sample.seq.load(std::memory_order_relaxed);
+
+    // The publisher lapped the ring mid-read; the next poll picks up the newer sample
+    if (seqBefore != 2 * count || seqAfter != seqBefore)
+        return;
+
+    m_lastWriteCount = count;
+
+    if (playerFrame == m_playerFrame && ghostFrame == m_ghostFrame)
+        return;
+
+    m_playerFrame = playerFrame;
+    m_ghostFrame = ghostFrame;
+    emit cursorMoved(playerFrame, ghostFrame);
+}
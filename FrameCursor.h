@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QObject>
+#include <QSharedMemory>
+
+#include <atomic>
+
+class QTimer;
+
+#define FRAME_CURSOR_KEY "TTKFrameCursor"
+#define FRAME_CURSOR_RING_SIZE 16
+#define NO_CURSOR_FRAME -1
+
+// Shared-memory layout. The publisher writes each sample into the next ring slot and then
+// bumps writeCount; readers only ever look at the newest slot. A slot's seq is odd while it
+// is being written and 2 * its write number once complete, so a torn read is detected
+// without either side taking a lock.
+struct FrameCursorSample
+{
+    std::atomic<quint64> seq;
+    std::atomic<qint32> playerFrame;
+    std::atomic<qint32> ghostFrame;
+};
+
+struct FrameCursorRing
+{
+    char magic[4];
+    quint32 version;
+    std::atomic<quint64> writeCount;
+    FrameCursorSample samples[FRAME_CURSOR_RING_SIZE];
+};
+
+// Emulator side (or the stand-in publisher): owns the shared memory segment
+class FrameCursorPublisher
+{
+public:
+    FrameCursorPublisher();
+
+    bool open();
+    void publish(int playerFrame, int ghostFrame);
+
+private:
+    QSharedMemory m_shm;
+    FrameCursorRing* m_pRing;
+};
+
+// Editor side: polls the segment on the UI thread and emits only when the frame changes.
+// Polling a couple of atomics every 16 ms is cheaper than any wakeup-based channel and
+// naturally caps updates at one per displayed frame.
+class FrameCursorReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameCursorReader(QObject* parent = nullptr);
+
+    void start();
+    void stop();
+
+signals:
+    void cursorMoved(int playerFrame, int ghostFrame);
+
+private:
+    void poll();
+    bool attach();
+
+    QSharedMemory m_shm;
+    const FrameCursorRing* m_pRing;
+    QTimer* m_pTimer;
+    quint64 m_lastWriteCount;
+    int m_pollsUntilAttach;
+    int m_playerFrame;
+    int m_ghostFrame;
+};
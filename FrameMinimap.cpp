@@ -0,0 +1,126 @@
+#include "FrameMinimap.h"
+
+#include "InputFile.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QTableView>
+
+#define NUM_LANES 3
+#define MAX_STICK_DEFLECTION 14
+
+// Buttons, sticks, DPad
+static const int LANE_COLORS[NUM_LANES][3] = { { 40, 90, 200 }, { 30, 150, 60 }, { 210, 120, 20 } };
+
+static QColor laneShade(int lane, double activity)
+{
+    activity = qBound(0.0, activity, 1.0);
+
+    int rgb[3];
+    for (int i = 0; i < 3; i++)
+        rgb[i] = 255 - static_cast<int>(activity * (255 - LANE_COLORS[lane][i]));
+
+    return QColor(rgb[0], rgb[1], rgb[2]);
+}
+
+FrameMinimap::FrameMinimap(QWidget* parent)
+    : QWidget(parent)
+    , m_pFile(nullptr)
+{
+    setFixedWidth(MINIMAP_WIDTH);
+}
+
+void FrameMinimap::setFile(InputFile* pInputFile)
+{
+    m_pFile = pInputFile;
+    update();
+}
+
+int FrameMinimap::frameCount() const
+{
+    return (m_pFile == nullptr) ? 0 : m_pFile->getData().count();
+}
+
+int FrameMinimap::rowAt(int y) const
+{
+    int count = frameCount();
+    if (count == 0 || height() == 0)
+        return 0;
+
+    return qBound(0, static_cast<int>(static_cast<qint64>(y) * count / height()), count - 1);
+}
+
+int FrameMinimap::yForRow(int rowIdx) const
+{
+    int count = frameCount();
+    return (count == 0) ? 0 : static_cast<int>(static_cast<qint64>(rowIdx) * height() / count);
+}
+
+void FrameMinimap::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(Qt::white));
+
+    int count = frameCount();
+    if (count == 0)
+        return;
+
+    const FrameSummary& summary = m_pFile->getSummary();
+    bool bSevenCentered = m_pFile->getCentering() == Centering::Seven;
+    int laneWidth = width() / NUM_LANES;
+
+    for (int y = 0; y < height(); y++)
+    {
+        int firstRow = rowAt(y);
+        int lastRow = qMax(firstRow, rowAt(y + 1) - 1);
+        BlockSummary block = summary.summarize(firstRow, lastRow);
+
+        if (block.frames == 0)
+            continue;
+
+        quint32 stick = bSevenCentered ? block.stickFromSeven : block.stickFromZero;
+        double activity[NUM_LANES] =
+        {
+            static_cast<double>(block.buttons) / (3.0 * block.frames),
+            static_cast<double>(stick) / (static_cast<double>(MAX_STICK_DEFLECTION) * block.frames),
+            static_cast<double>(block.dpad) / block.frames,
+        };
+
+        for (int lane = 0; lane < NUM_LANES; lane++)
+        {
+            painter.setPen(laneShade(lane, activity[lane]));
+            painter.drawLine(lane * laneWidth, y, (lane + 1) * laneWidth - 1, y);
+        }
+    }
+
+    // Outline the rows visible in the table
+    QTableView* pTable = m_pFile->getTableView();
+    int topRow = pTable->rowAt(0);
+    int bottomRow = pTable->rowAt(pTable->viewport()->height() - 1);
+
+    if (topRow < 0)
+        return;
+    if (bottomRow < 0)
+        bottomRow = count - 1;
+
+    int top = yForRow(topRow);
+    int bottom = qMax(top + 1, yForRow(bottomRow + 1) - 1);
+
+    painter.setPen(QColor(Qt::black));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawRect(0, top, width() - 1, bottom - top);
+}
+
+void FrameMinimap::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton && frameCount() > 0)
+        emit frameRequested(rowAt(event->y()));
+}
+
+void FrameMinimap::mouseMoveEvent(QMouseEvent* event)
+{
+    if ((event->buttons() & Qt::LeftButton) && frameCount() > 0)
+        emit frameRequested(rowAt(qBound(0, event->y(), height() - 1)));
+}
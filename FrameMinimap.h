@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QWidget>
+
+#define MINIMAP_WIDTH 30
+
+class InputFile;
+class QMouseEvent;
+class QPaintEvent;
+
+// Overview of a whole file drawn beside its table: button, stick and DPad activity in three
+// lanes, with the rows currently in view outlined. Each pixel row is read from the file's
+// FrameSummary, so a repaint costs O(height * log frames) no matter how long the file is.
+// Clicking or dragging asks for the table to jump to the frame under the mouse.
+class FrameMinimap : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FrameMinimap(QWidget* parent = nullptr);
+
+    void setFile(InputFile* pInputFile);
+
+signals:
+    void frameRequested(int rowIdx);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+private:
+    InputFile* m_pFile;
+
+    int frameCount() const;
+    int rowAt(int y) const;
+    int yForRow(int rowIdx) const;
+};
@@ -0,0 +1,145 @@
+#include "FrameResidency.h"
+
+#include "FrameCodec.h"
+#include "Trace.h"
+
+#include <cstring>
+
+FrameResidency& FrameResidency::instance()
+{
+    static FrameResidency s_instance;
+    return s_instance;
+}
+
+FrameResidency::FrameResidency(qint64 budgetBytes)
+    : m_budgetBytes(budgetBytes)
+    , m_clock(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+qint64 FrameResidency::frameBytes(const TtkFileData& frames)
+{
+    return static_cast<qint64>(frames.count()) * sizeof(TtkFrame);
+}
+
+int FrameResidency::add(const TtkFileData& frames)
+{
+    int handle;
+
+    if (m_freeHandles.isEmpty())
+    {
+        handle = m_entries.count();
+        m_entries.append(Entry());
+    }
+    else
+    {
+        handle = m_freeHandles.takeLast();
+    }
+
+    Entry& entry = m_entries[handle];
+    entry.frames = frames;
+    entry.packed.clear();
+    entry.lastUse = ++m_clock;
+    entry.bExpanded = true;
+    entry.bPinned = false;
+
+    m_stats.entries++;
+    m_stats.expandedBytes += frameBytes(frames);
+    enforceBudget(handle);
+
+    return handle;
+}
+
+void FrameResidency::remove(int handle)
+{
+    Entry& entry = m_entries[handle];
+
+    if (entry.bExpanded)
+        m_stats.expandedBytes -= frameBytes(entry.frames);
+    m_stats.compressedBytes -= entry.packed.size();
+    m_stats.entries--;
+
+    entry.frames = TtkFileData();
+    entry.packed = QByteArray();
+    entry.bExpanded = false;
+    entry.bPinned = false;
+    m_freeHandles.append(handle);
+}
+
+const TtkFileData& FrameResidency::acquire(int handle)
+{
+    Entry& entry = m_entries[handle];
+    entry.lastUse = ++m_clock;
+
+    if (entry.bExpanded)
+    {
+        m_stats.hits++;
+        return entry.frames;
+    }
+
+    TTK_TRACE_SCOPE("rehydrate");
+    m_stats.misses++;
+
+    // Only ever packed by evict, so this can't fail short of memory corruption
+    decompressFrames(entry.packed, &entry.frames);
+    entry.bExpanded = true;
+    m_stats.expandedBytes += frameBytes(entry.frames);
+    enforceBudget(handle);
+
+    return m_entries[handle].frames;
+}
+
+void FrameResidency::pin(int handle, bool bPinned)
+{
+    m_entries[handle].bPinned = bPinned;
+
+    if (!bPinned)
+        enforceBudget(-1);
+}
+
+void FrameResidency::setBudget(qint64 budgetBytes)
+{
+    m_budgetBytes = budgetBytes;
+    enforceBudget(-1);
+}
+
+void FrameResidency::enforceBudget(int keepHandle)
+{
+    // Few enough buffers are kept that a scan for the oldest beats keeping a list in order
+    while (m_stats.expandedBytes > m_budgetBytes)
+    {
+        int oldest = -1;
+
+        for (int i = 0; i < m_entries.count(); i++)
+        {
+            const Entry& entry = m_entries[i];
+            if (entry.bExpanded && !entry.bPinned && i != keepHandle && (oldest < 0 || entry.lastUse < m_entries[oldest].lastUse))
+                oldest = i;
+        }
+
+        if (oldest < 0)
+            return;
+
+        evict(oldest);
+    }
+}
+
+void FrameResidency::evict(int handle)
+{
+    TTK_TRACE_SCOPE("evict");
+
+    Entry& entry = m_entries[handle];
+
+    if (entry.packed.isEmpty())
+    {
+        compressFrames(entry.frames, &entry.packed);
+        entry.packed.squeeze();
+        m_stats.compressedBytes += entry.packed.size();
+    }
+
+    m_stats.expandedBytes -= frameBytes(entry.frames);
+    entry.frames = TtkFileData();
+    entry.bExpanded = false;
+    m_stats.evictions++;
+}
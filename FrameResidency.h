@@ -0,0 +1,64 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QByteArray>
+#include <QVector>
+
+#define RESIDENCY_DEFAULT_BUDGET (4 * 1024 * 1024)
+
+struct ResidencyStats
+{
+    quint64 hits;
+    quint64 misses;
+    quint64 evictions;
+    qint64 expandedBytes;
+    qint64 compressedBytes;
+    int entries;
+};
+
+// Frame buffers that are kept for later rather than shown, held within a memory budget.
+// Past the budget the least recently used buffers are dropped to their FrameCodec form and
+// expanded again the next time they are acquired. A buffer is compressed at most once, since
+// it never changes after it is added. UI thread only.
+class FrameResidency
+{
+public:
+    static FrameResidency& instance();
+
+    explicit FrameResidency(qint64 budgetBytes = RESIDENCY_DEFAULT_BUDGET);
+
+    int add(const TtkFileData& frames);
+    void remove(int handle);
+
+    // The frames stay valid until the next call into the residency; copy them to keep them
+    const TtkFileData& acquire(int handle);
+
+    // A pinned buffer is never evicted. Pin one while a copy of it is still shared elsewhere,
+    // since dropping it would then free nothing and only make the stats undercount.
+    void pin(int handle, bool bPinned);
+
+    void setBudget(qint64 budgetBytes);
+    inline qint64 getBudget() const { return m_budgetBytes; }
+    inline const ResidencyStats& getStats() const { return m_stats; }
+
+private:
+    struct Entry
+    {
+        TtkFileData frames;
+        QByteArray packed;
+        quint64 lastUse;
+        bool bExpanded;
+        bool bPinned;
+    };
+
+    QVector<Entry> m_entries;
+    QVector<int> m_freeHandles;
+    qint64 m_budgetBytes;
+    quint64 m_clock;
+    ResidencyStats m_stats;
+
+    void enforceBudget(int keepHandle);
+    void evict(int handle);
+    static qint64 frameBytes(const TtkFileData& frames);
+};
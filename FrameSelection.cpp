@@ -0,0 +1,176 @@
+#include "FrameSelection.h"
+
+#include <algorithm>
+#include <climits>
+
+int FrameRanges::frameCount() const
+{
+    int count = 0;
+    for (const FrameRange& range : m_ranges)
+        count += range.last - range.first + 1;
+
+    return count;
+}
+
+FrameRanges FrameRanges::fromSelection(const QItemSelection& selection)
+{
+    QVector<FrameRange> spans;
+    spans.reserve(selection.count());
+
+    for (const QItemSelectionRange& range : selection)
+    {
+        if (range.isValid())
+            spans.append({ range.top(), range.bottom() });
+    }
+
+    std::sort(spans.begin(), spans.end(), [](const FrameRange& a, const FrameRange& b) { return a.first < b.first; });
+
+    // Overlapping and touching spans become one range
+    FrameRanges frames;
+    for (const FrameRange& span : spans)
+    {
+        if (!frames.m_ranges.isEmpty() && span.first <= frames.m_ranges.last().last + 1)
+            frames.m_ranges.last().last = qMax(frames.m_ranges.last().last, span.last);
+        else
+            frames.m_ranges.append(span);
+    }
+
+    return frames;
+}
+
+FrameRanges FrameRanges::united(const FrameRanges& other) const
+{
+    return combined(other, Combine::Unite);
+}
+
+FrameRanges FrameRanges::subtracted(const FrameRanges& other) const
+{
+    return combined(other, Combine::Subtract);
+}
+
+FrameRanges FrameRanges::toggled(const FrameRanges& other) const
+{
+    return combined(other, Combine::Toggle);
+}
+
+FrameRanges FrameRanges::clampedTo(int frameCount) const
+{
+    FrameRanges frames;
+
+    for (const FrameRange& range : m_ranges)
+    {
+        if (range.first >= frameCount)
+            break;
+
+        frames.m_ranges.append({ range.first, qMin(range.last, frameCount - 1) });
+    }
+
+    return frames;
+}
+
+FrameRanges FrameRanges::combined(const FrameRanges& other, Combine op) const
+{
+    // Walk the boundaries of both sets in order, treating each range as [first, last + 1)
+    const QVector<FrameRange>& a = m_ranges;
+    const QVector<FrameRange>& b = other.m_ranges;
+    int aEdges = a.count() * 2;
+    int bEdges = b.count() * 2;
+
+    FrameRanges result;
+    bool bInA = false;
+    bool bInB = false;
+    bool bInResult = false;
+    int start = 0;
+
+    for (int i = 0, j = 0; i < aEdges || j < bEdges;)
+    {
+        int aPos = (i < aEdges) ? ((i % 2 == 0) ? a[i / 2].first : a[i / 2].last + 1) : INT_MAX;
+        int bPos = (j < bEdges) ? ((j % 2 == 0) ? b[j / 2].first : b[j / 2].last + 1) : INT_MAX;
+        int pos = qMin(aPos, bPos);
+
+        if (aPos == pos)
+        {
+            bInA = !bInA;
+            i++;
+        }
+        if (bPos == pos)
+        {
+            bInB = !bInB;
+            j++;
+        }
+
+        bool bIn = (op == Combine::Unite) ? (bInA || bInB)
+            : (op == Combine::Subtract) ? (bInA && !bInB)
+            : (bInA != bInB);
+
+        if (bIn && !bInResult)
+            start = pos;
+        else if (!bIn && bInResult)
+            result.m_ranges.append({ start, pos - 1 });
+
+        bInResult = bIn;
+    }
+
+    return result;
+}
+
+FrameSelectionModel::FrameSelectionModel(QAbstractItemModel* model, QObject* parent)
+    : QItemSelectionModel(model, parent)
+    , m_currentCommand(QItemSelectionModel::NoUpdate)
+    , m_bFramesDirty(false)
+{
+}
+
+FrameRanges FrameSelectionModel::applied(const FrameRanges& base, const FrameRanges& ranges, QItemSelectionModel::SelectionFlags command)
+{
+    // The same precedence as QItemSelection::merge
+    if (command & QItemSelectionModel::Deselect)
+        return base.subtracted(ranges);
+    if (command & QItemSelectionModel::Toggle)
+        return base.toggled(ranges);
+    if (command & QItemSelectionModel::Select)
+        return base.united(ranges);
+
+    return base;
+}
+
+void FrameSelectionModel::select(const QItemSelection& selection, QItemSelectionModel::SelectionFlags command)
+{
+    // Mirrors QItemSelectionModel: a Current selection stays separate (a drag in progress)
+    // until a select without Current commits it
+    if (command != QItemSelectionModel::NoUpdate)
+    {
+        if (command & QItemSelectionModel::Clear)
+        {
+            m_committed.clear();
+            m_current.clear();
+        }
+
+        if (!(command & QItemSelectionModel::Current))
+        {
+            m_committed = applied(m_committed, m_current, m_currentCommand);
+            m_current.clear();
+        }
+
+        if (command & (QItemSelectionModel::Select | QItemSelectionModel::Deselect | QItemSelectionModel::Toggle))
+        {
+            m_current = FrameRanges::fromSelection(selection);
+            m_currentCommand = command;
+        }
+
+        m_bFramesDirty = true;
+    }
+
+    QItemSelectionModel::select(selection, command);
+}
+
+const FrameRanges& FrameSelectionModel::frames() const
+{
+    if (m_bFramesDirty)
+    {
+        m_frames = applied(m_committed, m_current, m_currentCommand);
+        m_bFramesDirty = false;
+    }
+
+    return m_frames;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QItemSelectionModel>
+#include <QVector>
+
+struct FrameRange
+{
+    int first;
+    int last;
+};
+
+// A set of frames as sorted, disjoint ranges, so a selection of a whole race is one entry and
+// combining two sets costs one walk over their ranges.
+class FrameRanges
+{
+public:
+    inline bool isEmpty() const { return m_ranges.isEmpty(); }
+    inline const QVector<FrameRange>& ranges() const { return m_ranges; }
+    inline int firstFrame() const { return m_ranges.first().first; }
+    inline int lastFrame() const { return m_ranges.last().last; }
+    int frameCount() const;
+    inline void clear() { m_ranges.clear(); }
+
+    // The rows a selection touches, whatever its columns
+    static FrameRanges fromSelection(const QItemSelection& selection);
+
+    FrameRanges united(const FrameRanges& other) const;
+    FrameRanges subtracted(const FrameRanges& other) const;
+    FrameRanges toggled(const FrameRanges& other) const;
+    FrameRanges clampedTo(int frameCount) const;
+
+private:
+    QVector<FrameRange> m_ranges;
+
+    enum class Combine
+    {
+        Unite,
+        Subtract,
+        Toggle,
+    };
+
+    FrameRanges combined(const FrameRanges& other, Combine op) const;
+};
+
+// Selection model that keeps the selected frames as FrameRanges next to Qt's own selection.
+// Qt merges its committed and in-progress selections every time selection() is asked for,
+// which gets slow with many ranges; frames() mirrors the same select() calls on row ranges
+// and only recombines the two when something changed.
+class FrameSelectionModel : public QItemSelectionModel
+{
+    Q_OBJECT
+
+public:
+    explicit FrameSelectionModel(QAbstractItemModel* model, QObject* parent = nullptr);
+
+    using QItemSelectionModel::select;
+    void select(const QItemSelection& selection, QItemSelectionModel::SelectionFlags command) override;
+
+    const FrameRanges& frames() const;
+
+private:
+    FrameRanges m_committed;
+    FrameRanges m_current;
+    QItemSelectionModel::SelectionFlags m_currentCommand;
+    mutable FrameRanges m_frames;
+    mutable bool m_bFramesDirty;
+
+    static FrameRanges applied(const FrameRanges& base, const FrameRanges& ranges, QItemSelectionModel::SelectionFlags command);
+};
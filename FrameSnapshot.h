@@ -0,0 +1,29 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <memory>
+
+// An immutable copy of a file's frames at one version, safe to read from any thread.
+// The frames share the editor's buffer until its next edit, which then copies it once.
+struct FrameSnapshot
+{
+    quint64 version;
+    TtkFileData frames;
+    Centering centering;
+};
+
+typedef std::shared_ptr<const FrameSnapshot> FrameSnapshotPtr;
+
+// Holds the latest snapshot of a file. The UI thread publishes a new one when one is asked for
+// after an edit, and workers take whichever is current without locking; a snapshot a worker
+// still holds stays alive and unchanged until it lets go of it.
+class SnapshotSlot
+{
+public:
+    inline FrameSnapshotPtr load() const { return std::atomic_load(&m_current); }
+    inline void publish(const FrameSnapshotPtr& snapshot) { std::atomic_store(&m_current, snapshot); }
+
+private:
+    FrameSnapshotPtr m_current;
+};
@@ -0,0 +1,179 @@
+#include "FrameSummary.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#define SUMMARY_BLOCK_FRAMES 64
+
+static void addFrame(BlockSummary* pSummary, const TtkFrame& frame)
+{
+    pSummary->frames++;
+    pSummary->buttons += (frame.values[0] != 0) + (frame.values[1] != 0) + (frame.values[2] != 0);
+    pSummary->dpad += frame.values[5] != 0;
+    pSummary->stickFromZero += abs(frame.values[3]) + abs(frame.values[4]);
+    pSummary->stickFromSeven += abs(frame.values[3] - 7) + abs(frame.values[4] - 7);
+}
+
+static void addSummary(BlockSummary* pSummary, const BlockSummary& other)
+{
+    pSummary->frames += other.frames;
+    pSummary->buttons += other.buttons;
+    pSummary->dpad += other.dpad;
+    pSummary->stickFromZero += other.stickFromZero;
+    pSummary->stickFromSeven += other.stickFromSeven;
+}
+
+FrameSummary::FrameSummary()
+{
+}
+
+void FrameSummary::clear()
+{
+    m_levels.clear();
+    m_levels.squeeze();
+}
+
+void FrameSummary::rebuild(const TtkFileData& data)
+{
+    clear();
+
+    int numBlocks = (data.count() + SUMMARY_BLOCK_FRAMES - 1) / SUMMARY_BLOCK_FRAMES;
+    if (numBlocks == 0)
+        return;
+
+    QVector<BlockSummary> blocks(numBlocks);
+    memset(blocks.data(), 0, numBlocks * sizeof(BlockSummary));
+
+    for (int row = 0; row < data.count(); row++)
+        addFrame(&blocks[row / SUMMARY_BLOCK_FRAMES], data[row]);
+
+    m_levels.append(blocks);
+
+    while (m_levels.last().count() > 1)
+    {
+        const QVector<BlockSummary>& below = m_levels.last();
+        QVector<BlockSummary> level((below.count() + 1) / 2);
+
+        for (int i = 0; i < level.count(); i++)
+        {
+            level[i] = below[2 * i];
+            if (2 * i + 1 < below.count())
+                addSummary(&level[i], below[2 * i + 1]);
+        }
+
+        m_levels.append(level);
+    }
+}
+
+void FrameSummary::append(const TtkFileData& data, int firstRow)
+{
+    BlockSummary empty;
+    memset(&empty, 0, sizeof(empty));
+
+    if (m_levels.isEmpty())
+        m_levels.append(QVector<BlockSummary>());
+
+    for (int row = firstRow; row < data.count(); row++)
+    {
+        BlockSummary frame = empty;
+        addFrame(&frame, data[row]);
+
+        int block = row / SUMMARY_BLOCK_FRAMES;
+
+        for (int level = 0; ; level++)
+        {
+            if (level == m_levels.count())
+                m_levels.append(QVector<BlockSummary>());
+
+            QVector<BlockSummary>& nodes = m_levels[level];
+            int node = block >> level;
+
+            // A new parent starts as the sum of its children, which already include this frame
+            if (node < nodes.count())
+            {
+                addSummary(&nodes[node], frame);
+            }
+            else if (level == 0)
+            {
+                nodes.append(frame);
+            }
+            else
+            {
+                const QVector<BlockSummary>& below = m_levels[level - 1];
+                BlockSummary parent = below[2 * node];
+                if (2 * node + 1 < below.count())
+                    addSummary(&parent, below[2 * node + 1]);
+                nodes.append(parent);
+            }
+
+            if (level + 1 == m_levels.count() && nodes.count() == 1)
+                break;
+        }
+    }
+}
+
+void FrameSummary::update(const TtkFileData& data, int row, int col, int prevValue)
+{
+    if (m_levels.isEmpty())
+        return;
+
+    TtkFrame prevFrame = data[row];
+    prevFrame.values[col] = static_cast<qint8>(prevValue);
+
+    BlockSummary before, after;
+    memset(&before, 0, sizeof(before));
+    memset(&after, 0, sizeof(after));
+    addFrame(&before, prevFrame);
+    addFrame(&after, data[row]);
+
+    int block = row / SUMMARY_BLOCK_FRAMES;
+
+    // Unsigned wraparound makes adding the difference correct even when a count drops
+    for (int level = 0; level < m_levels.count(); level++)
+    {
+        BlockSummary& node = m_levels[level][block >> level];
+        node.buttons += after.buttons - before.buttons;
+        node.dpad += after.dpad - before.dpad;
+        node.stickFromZero += after.stickFromZero - before.stickFromZero;
+        node.stickFromSeven += after.stickFromSeven - before.stickFromSeven;
+    }
+}
+
+BlockSummary FrameSummary::summarize(int firstRow, int lastRow) const
+{
+    BlockSummary summary;
+    memset(&summary, 0, sizeof(summary));
+
+    if (m_levels.isEmpty() || firstRow > lastRow)
+        return summary;
+
+    // Bottom-up walk over the half-open block range, taking a node whenever
+    // the range only covers one of a pair of siblings
+    int lo = firstRow / SUMMARY_BLOCK_FRAMES;
+    int hi = qMin(lastRow / SUMMARY_BLOCK_FRAMES + 1, m_levels[0].count());
+
+    for (int level = 0; lo < hi; level++)
+    {
+        const QVector<BlockSummary>& nodes = m_levels[level];
+
+        if (lo & 1)
+            addSummary(&summary, nodes[lo++]);
+        if (hi & 1)
+            addSummary(&summary, nodes[--hi]);
+
+        lo >>= 1;
+        hi >>= 1;
+    }
+
+    return summary;
+}
+
+qint64 FrameSummary::memoryUsage() const
+{
+    qint64 bytes = 0;
+
+    for (const QVector<BlockSummary>& level : m_levels)
+        bytes += level.capacity() * sizeof(BlockSummary);
+
+    return bytes;
+}
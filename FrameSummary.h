@@ -0,0 +1,39 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+// Input activity over a run of frames. Stick deflection is kept from both centerings so
+// the summary doesn't need rebuilding when the file is switched between them.
+struct BlockSummary
+{
+    quint32 frames;
+    quint32 buttons;
+    quint32 dpad;
+    quint32 stickFromZero;
+    quint32 stickFromSeven;
+};
+
+// A pyramid of per-block activity summaries over a file. Level 0 summarizes fixed-size blocks
+// of frames and every level above halves the one below it, so any block range is covered by
+// O(log n) nodes. An edit updates one node per level.
+class FrameSummary
+{
+public:
+    FrameSummary();
+
+    void rebuild(const TtkFileData& data);
+    void clear();
+
+    // Call after rows from firstRow on were appended to data
+    void append(const TtkFileData& data, int firstRow);
+
+    // Call after data[row].values[col] has changed from prevValue
+    void update(const TtkFileData& data, int row, int col, int prevValue);
+
+    // Activity over the whole blocks holding rows firstRow..lastRow (inclusive)
+    BlockSummary summarize(int firstRow, int lastRow) const;
+    qint64 memoryUsage() const;
+
+private:
+    QVector<QVector<BlockSummary>> m_levels;
+};
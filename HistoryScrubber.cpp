@@ -0,0 +1,55 @@
+#include "HistoryScrubber.h"
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QSlider>
+
+HistoryScrubber::HistoryScrubber(QWidget* parent)
+    : QWidget(parent)
+    , m_fileStep(0)
+{
+    m_pSlider = new QSlider(Qt::Horizontal, this);
+    m_pLabel = new QLabel(this);
+    m_pRestoreButton = new QPushButton("Restore", this);
+    m_pRestoreButton->setEnabled(false);
+
+    QHBoxLayout* pLayout = new QHBoxLayout(this);
+    pLayout->setContentsMargins(0, 0, 0, 0);
+    pLayout->addWidget(m_pSlider, 1);
+    pLayout->addWidget(m_pLabel);
+    pLayout->addWidget(m_pRestoreButton);
+
+    connect(m_pSlider, &QSlider::valueChanged, this, &HistoryScrubber::onSliderMoved);
+    connect(m_pRestoreButton, &QPushButton::clicked, this, &HistoryScrubber::restoreRequested);
+}
+
+void HistoryScrubber::setSteps(int stepCount, int fileStep)
+{
+    m_fileStep = fileStep;
+
+    QSignalBlocker blocker(m_pSlider);
+    m_pSlider->setRange(0, qMax(0, stepCount - 1));
+    m_pSlider->setValue(fileStep);
+    updateLabel();
+}
+
+void HistoryScrubber::onSliderMoved(int step)
+{
+    updateLabel();
+    emit stepRequested(step);
+}
+
+void HistoryScrubber::updateLabel()
+{
+    int step = m_pSlider->value();
+    int distance = step - m_fileStep;
+
+    QString text = QString("%1/%2").arg(step).arg(m_pSlider->maximum());
+    if (distance != 0)
+        text += QString(" (%1%2)").arg(distance > 0 ? "+" : "").arg(distance);
+
+    m_pLabel->setText(text);
+    m_pRestoreButton->setEnabled(distance != 0);
+}
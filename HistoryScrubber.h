@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QWidget>
+
+class QLabel;
+class QPushButton;
+class QSlider;
+
+// A slider over a file's undo history, one position per undo step, shown under its table while
+// the history timeline is open. Moving it asks for that step to be previewed; Restore asks for
+// the file to be taken back (or forward) to the previewed step.
+class HistoryScrubber : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryScrubber(QWidget* parent = nullptr);
+
+    // Puts the slider on fileStep without asking for a preview
+    void setSteps(int stepCount, int fileStep);
+
+signals:
+    void stepRequested(int step);
+    void restoreRequested();
+
+private:
+    QSlider* m_pSlider;
+    QLabel* m_pLabel;
+    QPushButton* m_pRestoreButton;
+    int m_fileStep;
+
+    void onSliderMoved(int step);
+    void updateLabel();
+};
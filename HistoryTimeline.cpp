@@ -0,0 +1,164 @@
+#include "HistoryTimeline.h"
+
+#include "FrameResidency.h"
+
+#define HISTORY_CHECKPOINT_ACTIONS 1024
+
+HistoryTimeline::HistoryTimeline()
+    : m_pinnedCheckpoint(-1)
+    , m_previewActions(0)
+    , m_previewStep(0)
+    , m_fileStep(0)
+    , m_fileVersion(0)
+{
+}
+
+HistoryTimeline::~HistoryTimeline()
+{
+    clear();
+}
+
+void HistoryTimeline::clear()
+{
+    for (int handle : m_checkpoints)
+        FrameResidency::instance().remove(handle);
+
+    m_actions.clear();
+    m_stepEnds.clear();
+    m_checkpoints.clear();
+    m_pinnedCheckpoint = -1;
+    m_preview.clear();
+    m_previewActions = 0;
+    m_previewStep = 0;
+    m_fileStep = 0;
+}
+
+void HistoryTimeline::build(const TtkFileData& data, const TtkStack& undoStack, const TtkStack& redoStack, quint64 fileVersion)
+{
+    clear();
+
+    int undoCount = undoStack.count();
+    int redoCount = redoStack.count();
+    int total = undoCount + redoCount;
+
+    // Edits in the order they were made. A step ends where the next action isn't linked to it.
+    m_actions.reserve(total);
+    m_stepEnds.append(0);
+
+    for (int i = 0; i < undoCount; i++)
+    {
+        CellEditAction action = undoStack.at(i);
+
+        if (i > 0 && !action.isLinked())
+            m_stepEnds.append(i);
+
+        m_actions.append(action);
+    }
+
+    if (undoCount > 0)
+        m_stepEnds.append(undoCount);
+
+    m_fileStep = m_stepEnds.count() - 1;
+
+    // The redo stack holds the future newest first and flipped, with each group's unlinked action at its bottom
+    for (int i = redoCount - 1; i >= 0; i--)
+    {
+        CellEditAction action = redoStack.at(i);
+        bool bEndsStep = !action.isLinked() || i == 0;
+
+        action.flipValues();
+        m_actions.append(action);
+
+        if (bEndsStep)
+            m_stepEnds.append(m_actions.count());
+    }
+
+    // Walk back to the oldest state and forward to the newest from the file as it is now.
+    // Each checkpoint shares the frames until the next action detaches them, so it costs one copy.
+    FrameResidency& residency = FrameResidency::instance();
+    m_checkpoints.resize(total / HISTORY_CHECKPOINT_ACTIONS + 1);
+
+    TtkFileData frames = data;
+
+    if (undoCount % HISTORY_CHECKPOINT_ACTIONS == 0)
+        m_checkpoints[undoCount / HISTORY_CHECKPOINT_ACTIONS] = residency.add(frames);
+
+    for (int i = undoCount - 1; i >= 0; i--)
+    {
+        replay(&frames, i + 1, i);
+
+        if (i % HISTORY_CHECKPOINT_ACTIONS == 0)
+            m_checkpoints[i / HISTORY_CHECKPOINT_ACTIONS] = residency.add(frames);
+    }
+
+    frames = data;
+
+    for (int i = undoCount; i < total; i++)
+    {
+        replay(&frames, i, i + 1);
+
+        if ((i + 1) % HISTORY_CHECKPOINT_ACTIONS == 0)
+            m_checkpoints[(i + 1) / HISTORY_CHECKPOINT_ACTIONS] = residency.add(frames);
+    }
+
+    m_preview = data;
+    m_previewActions = undoCount;
+    m_previewStep = m_fileStep;
+    m_fileVersion = fileVersion;
+}
+
+int HistoryTimeline::seek(int step)
+{
+    if (!isBuilt())
+        return -1;
+
+    step = qBound(0, step, m_stepEnds.count() - 1);
+    int target = m_stepEnds[step];
+
+    // Start from the nearest checkpoint when that is closer than where the preview already is
+    int checkpoint = qMin((target + HISTORY_CHECKPOINT_ACTIONS / 2) / HISTORY_CHECKPOINT_ACTIONS, m_checkpoints.count() - 1);
+    int checkpointActions = checkpoint * HISTORY_CHECKPOINT_ACTIONS;
+
+    if (qAbs(target - checkpointActions) < qAbs(target - m_previewActions))
+    {
+        // The preview shares the checkpoint's frames, so the checkpoint stays expanded while
+        // the preview came from it: evicting it would free nothing
+        FrameResidency& residency = FrameResidency::instance();
+
+        if (m_pinnedCheckpoint >= 0)
+            residency.pin(m_pinnedCheckpoint, false);
+
+        m_pinnedCheckpoint = m_checkpoints[checkpoint];
+        m_preview = residency.acquire(m_pinnedCheckpoint);
+        residency.pin(m_pinnedCheckpoint, true);
+        m_previewActions = checkpointActions;
+    }
+
+    replay(&m_preview, m_previewActions, target);
+    m_previewActions = target;
+    m_previewStep = step;
+
+    if (m_actions.isEmpty())
+        return -1;
+
+    return m_actions[qMax(0, target - 1)].row();
+}
+
+void HistoryTimeline::replay(TtkFileData* pFrames, int fromActions, int toActions) const
+{
+    int frameCount = pFrames->count();
+
+    for (int i = fromActions; i < toActions; i++)
+    {
+        const CellEditAction& action = m_actions[i];
+        if (action.row() < frameCount)
+            (*pFrames)[action.row()].values[action.col()] = static_cast<qint8>(action.curNumber());
+    }
+
+    for (int i = fromActions - 1; i >= toActions; i--)
+    {
+        const CellEditAction& action = m_actions[i];
+        if (action.row() < frameCount)
+            (*pFrames)[action.row()].values[action.col()] = static_cast<qint8>(action.prevNumber());
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "EditHistory.h"
+#include "TtkFrame.h"
+
+#include <QVector>
+#include <QtGlobal>
+
+// Every state a file's undo history can reach, laid out as one line of undo steps: step 0 is the
+// file before its oldest undoable edit and the last step is after its newest redoable one. The
+// history is replayed once into a frame checkpoint every 1024 edits, so previewing any
+// step copies the nearest checkpoint (or keeps the current preview) and replays only the edits
+// in between, whatever the length of the history. Checkpoints live in the FrameResidency, so
+// the ones not visited lately only cost their compressed size.
+class HistoryTimeline
+{
+public:
+    HistoryTimeline();
+    ~HistoryTimeline();
+
+    // data is the file as it is now, at the step between the two stacks
+    void build(const TtkFileData& data, const TtkStack& undoStack, const TtkStack& redoStack, quint64 fileVersion);
+    void clear();
+
+    inline bool isBuilt() const { return !m_stepEnds.isEmpty(); }
+    inline bool isCurrentFor(quint64 fileVersion) const { return isBuilt() && m_fileVersion == fileVersion; }
+    inline int stepCount() const { return m_stepEnds.count(); }
+    inline int fileStep() const { return m_fileStep; }
+    inline int previewStep() const { return m_previewStep; }
+    inline const TtkFileData& preview() const { return m_preview; }
+
+    // Moves the preview to a step. Returns the row of the edit the step ends with, or -1.
+    int seek(int step);
+
+private:
+    Q_DISABLE_COPY(HistoryTimeline)
+
+    QVector<CellEditAction> m_actions;
+    QVector<int> m_stepEnds;
+    QVector<int> m_checkpoints;
+    int m_pinnedCheckpoint;
+    TtkFileData m_preview;
+    int m_previewActions;
+    int m_previewStep;
+    int m_fileStep;
+    quint64 m_fileVersion;
+
+    void replay(TtkFileData* pFrames, int fromActions, int toActions) const;
+};
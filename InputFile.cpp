@@ -1,36 +1,25 @@
 #include "InputFile.h"
 #include "InputFileModel.h"
 
+#include "ContentHash.h"
+#include "SnapshotCache.h"
+#include "Trace.h"
+#include "RkgFile.h"
+#include "TtkbFile.h"
+
 #include <QAction>
+#include <QDateTime>
 #include <QFile>
-#include <QFileSystemWatcher>
+#include <QFileInfo>
 #include <QLabel>
 #include <QMenu>
 #include <QTableView>
 #include <QTextStream>
 
 #define INVALID_IDX -1
-
-CellEditAction::CellEditAction()
-    : m_rowIdx(INVALID_IDX)
-    , m_colIdx(INVALID_IDX)
-    , m_prev("")
-    , m_cur("")
-{
-}
-
-CellEditAction::CellEditAction(int row, int col, QString prev, QString cur)
-    : m_rowIdx(row)
-    , m_colIdx(col)
-    , m_prev(prev)
-    , m_cur(cur)
-{
-}
-
-bool CellEditAction::operator==(const CellEditAction& rhs)
-{
-    return m_rowIdx == rhs.m_rowIdx && m_colIdx == rhs.m_colIdx && m_cur == rhs.m_cur;
-}
+#define STATS_REBUILD_RATIO 16
+#define TAIL_SCAN_BYTES 4096
+#define TAIL_SIGNATURE_BYTES 64
 
 InputFile::InputFile(const InputFileMenus& menus, QLabel* label, QTableView* tableView)
     : m_filePath("")
@@ -40,46 +29,373 @@ InputFile::InputFile(const InputFileMenus& menus, QLabel* label, QTableView* tab
     , m_menus(menus)
     , pLabel(label)
     , m_frameParseError(INVALID_IDX)
-    , m_pFsWatcher(nullptr)
+    , m_contentHash(0)
+    , m_diskSize(0)
+    , m_diskMtime(0)
+    , m_bMatchesDisk(false)
+    , m_bRemoteWriter(false)
+    , m_version(0)
+    , m_publishedVersion(0)
+    , m_bFollowTail(false)
+    , m_bTailValid(false)
+    , m_bPartialLine(false)
+    , m_loadedBytes(0)
+    , m_parsedBytes(0)
 {
+    publishSnapshot();
 }
 
 FileStatus InputFile::loadFile(QString path)
 {
-    m_filePath = path;
+    return adoptFile(path, readFile(path, m_fileCentering));
+}
 
-    QFile fp(m_filePath);
+static void statFile(const QString& path, qint64* pSize, qint64* pMtime)
+{
+    QFileInfo info(path);
+    *pSize = info.size();
+    *pMtime = info.lastModified().toMSecsSinceEpoch();
+}
+
+LoadedFile InputFile::readFile(const QString& path, Centering centering)
+{
+    TTK_TRACE_SCOPE("load");
+
+    LoadedFile loaded;
+    loaded.status = FileStatus::Success;
+    loaded.centering = centering;
+    loaded.contentHash = 0;
+    loaded.parseErrorLine = INVALID_IDX;
+
+    QFile fp(path);
     if (!fp.open(QIODevice::ReadWrite))
-        return FileStatus::WritePermission;
+    {
+        loaded.status = FileStatus::WritePermission;
+        return loaded;
+    }
 
-    QTextStream ts(&fp);
+    // Stat before reading so a write that lands mid-read leaves the snapshot stale, not wrong
+    statFile(path, &loaded.diskSize, &loaded.diskMtime);
+    loaded.loadedBytes = loaded.diskSize;
 
-    while (!ts.atEnd())
+    if (TtkbFile::isTtkbPath(path))
     {
-        QString line = ts.readLine();
-        QStringList frameData = line.split(',');
+        fp.close();
+        loaded.status = TtkbFile::load(path, &loaded.data, &loaded.centering, &loaded.contentHash);
+        return loaded;
+    }
+
+    if (RkgFile::isRkgPath(path))
+    {
+        fp.close();
+        loaded.status = RkgFile::load(path, &loaded.data, &loaded.contentHash);
+        loaded.centering = Centering::Seven;
+        return loaded;
+    }
+
+    if (SnapshotCache::load(path, loaded.diskSize, loaded.diskMtime, &loaded.data, &loaded.centering, &loaded.contentHash))
+        return loaded;
+
+    QByteArray bytes = fp.readAll();
+    loaded.contentHash = contentHash(bytes.constData(), bytes.size());
+    loaded.loadedBytes = bytes.size();
 
-        if (!valuesFormattedProperly(frameData))
+    {
+        TTK_TRACE_SCOPE("parse");
+
+        QTextStream ts(bytes);
+        CsvFrameParser parser(centering);
+
+        while (!ts.atEnd())
         {
-            m_frameParseError = m_fileData.count() + 1;
-            clearData();
-            return FileStatus::Parse;
+            TtkFrame frame;
+
+            if (!parser.parseLine(ts.readLine(), &frame))
+            {
+                loaded.status = FileStatus::Parse;
+                loaded.parseErrorLine = loaded.data.count() + 1;
+                loaded.data.clear();
+                return loaded;
+            }
+
+            loaded.data.append(frame);
         }
 
-        m_fileData.append(frameData.toVector());
+        loaded.centering = parser.getCentering();
+    }
+
+    qint64 size, mtime;
+    statFile(path, &size, &mtime);
+    if (size == loaded.diskSize && mtime == loaded.diskMtime)
+        SnapshotCache::save(path, loaded.diskSize, loaded.diskMtime, loaded.data, loaded.centering, loaded.contentHash);
+
+    return loaded;
+}
+
+FileStatus InputFile::adoptFile(const QString& path, const LoadedFile& loaded)
+{
+    m_filePath = path;
+
+    if (loaded.status != FileStatus::Success)
+    {
+        if (loaded.status == FileStatus::Parse)
+            m_frameParseError = loaded.parseErrorLine;
+
+        clearData();
+        return loaded.status;
     }
 
-    m_pFsWatcher = new QFileSystemWatcher(QStringList(path));
+    m_fileData = loaded.data;
+    m_fileCentering = loaded.centering;
+    m_contentHash = loaded.contentHash;
+    m_diskSize = loaded.diskSize;
+    m_diskMtime = loaded.diskMtime;
+    m_loadedBytes = loaded.loadedBytes;
+    m_bMatchesDisk = true;
+    m_stats.rebuild(m_fileData);
+    m_summary.rebuild(m_fileData);
+    markChanged();
+    captureTail();
 
     return FileStatus::Success;
 }
 
+void InputFile::setCellNumber(int rowIdx, int colIdx, int value)
+{
+    writeCell(rowIdx, colIdx, value);
+    markChanged();
+}
+
+void InputFile::writeCell(int rowIdx, int colIdx, int value)
+{
+    int prevValue = m_fileData[rowIdx].values[colIdx];
+    m_fileData[rowIdx].values[colIdx] = static_cast<qint8>(value);
+    m_bMatchesDisk = false;
+    m_stats.update(m_fileData, rowIdx, colIdx, prevValue);
+    m_summary.update(m_fileData, rowIdx, colIdx, prevValue);
+}
+
+void InputFile::applyEdits(const QVector<CellEditAction>& edits)
+{
+    if (edits.count() < m_fileData.count() / STATS_REBUILD_RATIO)
+    {
+        for (const CellEditAction& edit : edits)
+            writeCell(edit.row(), edit.col(), edit.curNumber());
+
+        markChanged();
+        return;
+    }
+
+    // Past a point one O(n) rebuild of the stats and summary beats an O(log n) update per cell
+    for (const CellEditAction& edit : edits)
+        m_fileData[edit.row()].values[edit.col()] = static_cast<qint8>(edit.curNumber());
+
+    m_bMatchesDisk = false;
+    m_stats.rebuild(m_fileData);
+    m_summary.rebuild(m_fileData);
+    markChanged();
+}
+
+void InputFile::offsetSticks(int offset)
+{
+    for (int i = 0; i < m_fileData.count(); i++)
+    {
+        m_fileData[i].values[3] += offset;
+        m_fileData[i].values[4] += offset;
+    }
+
+    m_bMatchesDisk = false;
+    m_stats.rebuild(m_fileData);
+    m_summary.rebuild(m_fileData);
+    markChanged();
+}
+
+void InputFile::setCentering(Centering center)
+{
+    m_fileCentering = center;
+    markChanged();
+}
+
+FrameSnapshotPtr InputFile::snapshot()
+{
+    // Published only when asked for. A snapshot shares m_fileData's buffer, so the next edit
+    // after one copies the frames once; publishing on every edit would copy on every edit.
+    if (m_publishedVersion != m_version)
+        publishSnapshot();
+
+    return m_snapshot.load();
+}
+
+void InputFile::publishSnapshot()
+{
+    std::shared_ptr<FrameSnapshot> snapshot = std::make_shared<FrameSnapshot>();
+    snapshot->version = m_version;
+    snapshot->frames = m_fileData;
+    snapshot->centering = m_fileCentering;
+
+    m_publishedVersion = m_version;
+    m_snapshot.publish(snapshot);
+}
+
+void InputFile::noteWrittenToDisk(quint64 contentHash)
+{
+    m_contentHash = contentHash;
+    statFile(m_filePath, &m_diskSize, &m_diskMtime);
+    m_loadedBytes = m_diskSize;
+    m_bMatchesDisk = true;
+    captureTail();
+}
+
+void InputFile::setFollowTail(bool bFollow)
+{
+    m_bFollowTail = bFollow;
+
+    // Only a file still exactly as it was read or written can be followed from where that stopped
+    qint64 size, mtime;
+    statFile(m_filePath, &size, &mtime);
+
+    if (size == m_diskSize && mtime == m_diskMtime)
+        captureTail();
+    else
+        m_bTailValid = false;
+}
+
+void InputFile::captureTail()
+{
+    m_bTailValid = false;
+
+    if (!m_bFollowTail || m_filePath == "" || TtkbFile::isTtkbPath(m_filePath) || RkgFile::isRkgPath(m_filePath))
+        return;
+
+    QFile fp(m_filePath);
+    qint64 start = qMax<qint64>(0, m_loadedBytes - TAIL_SCAN_BYTES);
+
+    if (!fp.open(QIODevice::ReadOnly) || !fp.seek(start))
+        return;
+
+    QByteArray window = fp.read(m_loadedBytes - start);
+    if (window.size() != m_loadedBytes - start)
+        return;
+
+    // Appends are read from the end of the last complete line. A final line without a newline
+    // was still parsed as a frame, which the line is re-read to replace once it is finished.
+    int lineEnd = window.lastIndexOf('\n') + 1;
+    if (lineEnd == 0 && start > 0)
+        return;
+
+    int signatureStart = qMax(0, lineEnd - TAIL_SIGNATURE_BYTES);
+    m_parsedBytes = start + lineEnd;
+    m_bPartialLine = m_parsedBytes < m_loadedBytes;
+    m_tailSignature = window.mid(signatureStart, lineEnd - signatureStart);
+    m_bTailValid = true;
+}
+
+TailStatus InputFile::readAppended(AppendedFrames* pAppended)
+{
+    TTK_TRACE_SCOPE("readAppended");
+
+    if (!m_bTailValid)
+        return TailStatus::Reload;
+
+    qint64 size, mtime;
+    statFile(m_filePath, &size, &mtime);
+
+    // Anything but growth is a rewrite
+    if (size <= m_loadedBytes)
+        return (size == m_diskSize && mtime == m_diskMtime) ? TailStatus::Unchanged : TailStatus::Reload;
+
+    QFile fp(m_filePath);
+    if (!fp.open(QIODevice::ReadOnly) || !fp.seek(m_parsedBytes - m_tailSignature.size()))
+        return TailStatus::Reload;
+
+    // The bytes just before the new ones must be the ones last read, or this isn't an append
+    if (fp.read(m_tailSignature.size()) != m_tailSignature)
+        return TailStatus::Reload;
+
+    QByteArray chunk = fp.read(size - m_parsedBytes);
+    int lineEnd = chunk.lastIndexOf('\n') + 1;
+
+    // Nothing new until a line is finished
+    if (lineEnd == 0)
+        return TailStatus::Unchanged;
+
+    CsvFrameParser parser(m_fileCentering);
+    pAppended->frames.clear();
+
+    for (int lineStart = 0; lineStart < lineEnd; )
+    {
+        int newline = chunk.indexOf('\n', lineStart);
+        int length = newline - lineStart;
+
+        if (length > 0 && chunk.at(newline - 1) == '\r')
+            length--;
+
+        // Let the full reload report where the file is broken
+        TtkFrame frame;
+        if (!parser.parseLine(QString::fromLatin1(chunk.constData() + lineStart, length), &frame))
+            return TailStatus::Reload;
+
+        pAppended->frames.append(frame);
+        lineStart = newline + 1;
+    }
+
+    // Extend the hash of what was read before with the bytes read for the first time; an
+    // unfinished last line was already hashed up to where it ended
+    int hashedBytes = qBound(0, static_cast<int>(m_loadedBytes - m_parsedBytes), lineEnd);
+
+    pAppended->bReplacesLast = m_bPartialLine;
+    pAppended->centering = parser.getCentering();
+    pAppended->contentHash = contentHash(chunk.constData() + hashedBytes, lineEnd - hashedBytes, m_contentHash);
+    pAppended->parsedBytes = m_parsedBytes + lineEnd;
+    pAppended->signature = (m_tailSignature + chunk.left(lineEnd)).right(TAIL_SIGNATURE_BYTES);
+    pAppended->diskSize = size;
+    pAppended->diskMtime = mtime;
+
+    return TailStatus::Appended;
+}
+
+void InputFile::adoptAppended(const AppendedFrames& appended)
+{
+    int firstFrame = 0;
+
+    if (appended.bReplacesLast)
+    {
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+            writeCell(m_fileData.count() - 1, col, appended.frames[0].values[col]);
+        firstFrame = 1;
+    }
+
+    int firstRow = m_fileData.count();
+
+    for (int i = firstFrame; i < appended.frames.count(); i++)
+        m_fileData.append(appended.frames[i]);
+
+    m_stats.append(m_fileData, firstRow);
+    m_summary.append(m_fileData, firstRow);
+
+    // A trailing unfinished line is left for the next read
+    m_fileCentering = appended.centering;
+    m_contentHash = appended.contentHash;
+    m_loadedBytes = appended.parsedBytes;
+    m_parsedBytes = appended.parsedBytes;
+    m_bPartialLine = false;
+    m_tailSignature = appended.signature;
+    m_diskSize = appended.diskSize;
+    m_diskMtime = appended.diskMtime;
+    m_bMatchesDisk = (m_loadedBytes == m_diskSize);
+    markChanged();
+}
+
 void InputFile::onCellClicked(const QModelIndex& index)
 {
     // Only care about the button columns
-    if (index.column() < 1 || index.column() > 3)
+    int colIdx = index.column() - FRAMECOUNT_COLUMN;
+    if (colIdx < 0 || colIdx >= NUM_INPUT_COLUMNS || !isButtonColumn(colIdx))
         return;
 
+    TTK_TRACE_SCOPE("cellClicked");
+    TTK_TRACE_EDIT_START();
+
     // Get current value
     QVariant prevVal = pTableView->model()->data(index, Qt::CheckStateRole);
     QVariant newVal = (prevVal == Qt::Checked) ? Qt::Unchecked : Qt::Checked;
@@ -88,94 +404,107 @@ void InputFile::onCellClicked(const QModelIndex& index)
     pTableView->model()->setData(index, newVal, Qt::EditRole);
 }
 
-void InputFile::fileChanged()
+bool InputFile::fileChanged()
 {
+    // Our own writes land here too; the file is unchanged since we wrote or loaded it
+    qint64 size, mtime;
+    statFile(m_filePath, &size, &mtime);
+    if (size == m_diskSize && mtime == m_diskMtime)
+        return false;
+
+    TTK_TRACE_SCOPE("reload");
+
     m_fileData.clear();
     loadFile(m_filePath);
+    return true;
 }
 
 void InputFile::clearData()
 {
     m_filePath = "";
     m_fileData.clear();
+    m_stats.clear();
+    m_summary.clear();
+    m_bTailValid = false;
+    markChanged();
 }
 
-bool InputFile::valuesFormattedProperly(const QStringList& data)
+bool InputFile::ableToDiscernCentering(int value)
 {
-    // There should be 6 comma-separated values per line
-    if (data.count() != NUM_INPUT_COLUMNS)
-        return false;
-
-    // Certain columns have restricted values
-    if (!valueRestrictionsAreMet(data))
+    if (value > 7)
+        m_fileCentering = Centering::Seven;
+    else if (value < 0)
+        m_fileCentering = Centering::Zero;
+    else
         return false;
 
-    // Place other error checks here
-
     return true;
 }
 
-bool InputFile::valueRestrictionsAreMet(const QStringList& data)
-{
-    for (int i = 0; i < data.count(); i++)
-    {
-        bool ret;
-        int value = data[i].toInt(&ret);
-
-        if (!ret)
-            return false;
 
-        int smallestAcceptedVal = getSmallestAcceptedValue(i, value);
-        int largestAcceptedVal = getLargestAcceptedValue(i, value);
-
-        if (value > largestAcceptedVal || value < smallestAcceptedVal)
-            return false;
-    }
-
-    return true;
+bool InputFile::restoreHistory()
+{
+    return m_historySidecar.map(m_filePath, m_contentHash, &m_undoStack, &m_redoStack);
 }
 
-int InputFile::getSmallestAcceptedValue(int index, int value)
+void InputFile::saveHistory()
 {
-    if (BUTTON_COL_IDXS.contains(index) || DPAD_COL_IDX == index)
-        return 0;
+    // Key the history to what is on disk now, since edits have been written since loading.
+    // Frames that differ from disk would pair the history position with the wrong content.
+    if (m_filePath == "" || !m_bMatchesDisk)
+        return;
 
-    if (m_fileCentering == Centering::Unknown && !ableToDiscernCentering(value))
-        return 0;
+    quint64 hash;
+    if (!contentHashOnDisk(&hash))
+        return;
 
-    return m_fileCentering == Centering::Seven ? 0 : -7;
+    m_historySidecar.save(m_filePath, hash, &m_undoStack, &m_redoStack);
+    saveSnapshot(hash);
 }
 
-int InputFile::getLargestAcceptedValue(int index, int value)
+void InputFile::saveSnapshot(quint64 hash)
 {
-    if (DPAD_COL_IDX == index)
-        return 4;
-    if (BUTTON_COL_IDXS.contains(index))
-        return 1;
-    if (m_fileCentering == Centering::Unknown && !ableToDiscernCentering(value))
-        return 7;
+    if (TtkbFile::isTtkbPath(m_filePath) || RkgFile::isRkgPath(m_filePath) || !m_bMatchesDisk)
+        return;
 
-    return m_fileCentering == Centering::Seven ? 14 : 7;
+    // Only when the CSV is still exactly what was loaded or last written from here,
+    // so the in-memory frames are a faithful snapshot of it
+    qint64 size, mtime;
+    statFile(m_filePath, &size, &mtime);
+    if (size == m_diskSize && mtime == m_diskMtime)
+        SnapshotCache::save(m_filePath, size, mtime, m_fileData, m_fileCentering, hash);
 }
 
-bool InputFile::ableToDiscernCentering(int value)
+bool InputFile::contentHashOnDisk(quint64* pHash)
 {
-    if (value > 7)
-        m_fileCentering = Centering::Seven;
-    else if (value < 0)
-        m_fileCentering = Centering::Zero;
-    else
+    // Binary files already carry a checksum of their frames in the header
+    if (TtkbFile::isTtkbPath(m_filePath))
+        return TtkbFile::readChecksum(m_filePath, pHash);
+    if (RkgFile::isRkgPath(m_filePath))
+        return RkgFile::readChecksum(m_filePath, pHash);
+
+    QFile fp(m_filePath);
+    if (!fp.open(QIODevice::ReadOnly))
         return false;
 
+    QByteArray bytes = fp.readAll();
+    *pHash = contentHash(bytes.constData(), bytes.size());
     return true;
 }
 
+qint64 InputFile::memoryUsage()
+{
+    return m_fileData.capacity() * sizeof(TtkFrame) + m_stats.memoryUsage() + m_summary.memoryUsage();
+}
 
 void InputFile::closeFile()
 {
-    clearData();
+    saveHistory();
+    m_undoStack.clear();
+    m_redoStack.clear();
+    m_historySidecar.unmap();
     m_fileCentering = Centering::Unknown;
-    delete m_pFsWatcher;
+    clearData();
     pLabel->setVisible(false);
     pTableView->setVisible(false);
     m_menus.root->setVisible(false);
@@ -183,24 +512,20 @@ void InputFile::closeFile()
 
 bool InputFile::inputValid(const QModelIndex& index, const QVariant& value)
 {
+    TTK_TRACE_SCOPE("validate");
+
     if (value == "")
         return false;
 
     int iValue = value.toInt();
-    if (BUTTON_COL_IDXS.contains(index.column() - FRAMECOUNT_COLUMN))
-        return (iValue == 0 || iValue == 1);
-    if (index.row() == DPAD_COL_IDX + FRAMECOUNT_COLUMN)
-        return (iValue >= 0 && iValue <= 4);
-    
-    if (m_fileCentering == Centering::Seven)
-        return (iValue >= 0 && iValue <= 14);
-    if (m_fileCentering == Centering::Zero)
-        return (iValue >= -7 && iValue <= 7);
-    
-    // File centering is unknown... check extreme bounds
-    if (iValue < -7 || iValue > 14)
+    int colIdx = index.column() - FRAMECOUNT_COLUMN;
+
+    if (!valueInRange(colIdx, iValue, m_fileCentering))
         return false;
 
-    ableToDiscernCentering(iValue);
+    // A stick value may reveal the file's centering
+    if (m_fileCentering == Centering::Unknown && isStickColumn(colIdx))
+        ableToDiscernCentering(iValue);
+
     return true;
 }
\ No newline at end of file
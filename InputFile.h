@@ -1,60 +1,57 @@
 #pragma once
 
-#include <QStack>
+#include "EditHistory.h"
+#include "FrameSnapshot.h"
+#include "FrameSummary.h"
+#include "InputStats.h"
+#include "TtkFrame.h"
 
-#define NUM_INPUT_COLUMNS 6
-#define FRAMECOUNT_COLUMN 1
+#include <QByteArray>
 
-enum class FileStatus
+enum class EOperationType
 {
-    Success = 0,
-    WritePermission,
-    Parse,
+    Normal = 0,
+    Undo,
+    Redo,
 };
 
-enum class Centering
+// Result of reading a file from disk. Produced without touching any UI so it can be
+// done off the UI thread (e.g. while Qt starts up) and handed to InputFile::adoptFile.
+struct LoadedFile
 {
-    Unknown = 0,
-    Seven,
-    Zero,
+    FileStatus status;
+    TtkFileData data;
+    Centering centering;
+    quint64 contentHash;
+    qint64 diskSize;
+    qint64 diskMtime;
+    qint64 loadedBytes;
+    int parseErrorLine;
 };
 
-class CellEditAction
+enum class TailStatus
 {
-public:
-    CellEditAction();
-    CellEditAction(int row, int col, QString prev, QString cur);
-
-    bool operator==(const CellEditAction& rhs);
-    inline void flipValues()
-    {
-        QString temp = m_cur;
-        m_cur = m_prev;
-        m_prev = temp;
-    }
-    inline int row() { return m_rowIdx; }
-    inline int col() { return m_colIdx; }
-    inline QString curVal() { return m_cur; }
-
-private:
-    int m_rowIdx;
-    int m_colIdx;
-    QString m_prev;
-    QString m_cur;
+    Unchanged = 0,
+    Appended,
+    Reload,
 };
 
-enum class EOperationType
+// Complete lines appended to a CSV since it was last read, parsed by InputFile::readAppended
+// and applied with InputFile::adoptAppended. If the file ended in an unterminated line when
+// it was read, the first frame here is that line finished and replaces the last frame.
+struct AppendedFrames
 {
-    Normal = 0,
-    Undo,
-    Redo,
+    TtkFileData frames;
+    bool bReplacesLast;
+    Centering centering;
+    quint64 contentHash;
+    qint64 parsedBytes;
+    QByteArray signature;
+    qint64 diskSize;
+    qint64 diskMtime;
 };
 
-typedef QVector<QVector<QString>> TtkFileData;
-typedef QStack<CellEditAction> TtkStack;
-
 class QAction;
-class QFileSystemWatcher;
 class QLabel;
 class QMenu;
 class QModelIndex;
@@ -89,23 +86,51 @@ public:
 
     inline QString getPath() { return m_filePath; }
     const inline TtkFileData& getData() { return m_fileData; }
-    inline QString getCellValue(int rowIdx, int colIdx) { return m_fileData[rowIdx][colIdx]; }
-    inline void setCellValue(int rowIdx, int colIdx, QString value) { m_fileData[rowIdx][colIdx] = value; }
+
+    // The frames as of the last edit, for reading off the UI thread. getData, snapshot and the
+    // edit functions below belong to the UI thread only; other threads are handed a snapshot or
+    // take publishedSnapshot, which is whatever the UI thread last asked for.
+    FrameSnapshotPtr snapshot();
+    inline FrameSnapshotPtr publishedSnapshot() const { return m_snapshot.load(); }
+    inline quint64 getVersion() const { return m_version; }
+    inline QString getCellValue(int rowIdx, int colIdx) { return QString::number(m_fileData[rowIdx].values[colIdx]); }
+    inline void setCellValue(int rowIdx, int colIdx, QString value) { setCellNumber(rowIdx, colIdx, value.toInt()); }
+    inline int getCellNumber(int rowIdx, int colIdx) { return m_fileData[rowIdx].values[colIdx]; }
+    void setCellNumber(int rowIdx, int colIdx, int value);
+    void offsetSticks(int offset);
+    void applyEdits(const QVector<CellEditAction>& edits);
+    inline ColumnStats getColumnStats(int firstRow, int lastRow, int colIdx) { return m_stats.query(m_fileData, firstRow, lastRow, colIdx); }
+    const inline FrameSummary& getSummary() { return m_summary; }
     FileStatus loadFile(QString path);
+    static LoadedFile readFile(const QString& path, Centering centering);
+    FileStatus adoptFile(const QString& path, const LoadedFile& loaded);
+    void noteWrittenToDisk(quint64 contentHash);
+    inline quint64 getContentHash() const { return m_contentHash; }
+    bool contentHashOnDisk(quint64* pHash);
+    inline void setRemoteWriter(bool bRemote) { m_bRemoteWriter = bRemote; }
+    inline bool hasRemoteWriter() { return m_bRemoteWriter; }
     void closeFile();
     inline Centering getCentering() { return m_fileCentering; }
-    inline void setCentering(Centering center) { m_fileCentering = center; }
+    void setCentering(Centering center);
     inline void setTableView(QTableView* tableView) { pTableView = tableView; }
     inline QTableView* getTableView() { return pTableView; }
     const inline InputFileMenus& getMenus() { return m_menus; }
     inline QLabel* getLabel() { return pLabel; }
     bool inputValid(const QModelIndex& index, const QVariant& value);
     inline int getParseError() { return m_frameParseError; }
-    inline QStack<CellEditAction>* getUndoStack() { return &m_undoStack; }
-    inline QStack<CellEditAction>* getRedoStack() { return &m_redoStack; }
-    inline QFileSystemWatcher* getFsWatcher() { return m_pFsWatcher; }
-    void fileChanged();
+    inline TtkStack* getUndoStack() { return &m_undoStack; }
+    inline TtkStack* getRedoStack() { return &m_redoStack; }
+    bool restoreHistory();
+    void saveHistory();
+    bool fileChanged();
+
+    // While following, a CSV that only grew is read from where the last read stopped
+    void setFollowTail(bool bFollow);
+    inline bool isFollowingTail() { return m_bFollowTail; }
+    TailStatus readAppended(AppendedFrames* pAppended);
+    void adoptAppended(const AppendedFrames& appended);
     void onCellClicked(const QModelIndex& index);
+    qint64 memoryUsage();
 
 private:
 
@@ -113,22 +138,36 @@ private:
     TtkFileData m_fileData;
     Centering m_fileCentering;
     bool m_tableViewLoaded;
-    QStack<CellEditAction> m_undoStack;
-    QStack<CellEditAction> m_redoStack;
+    InputStats m_stats;
+    FrameSummary m_summary;
+    TtkStack m_undoStack;
+    TtkStack m_redoStack;
+    HistorySidecar m_historySidecar;
     QTableView* pTableView;
     QLabel* pLabel;
     InputFileMenus m_menus;
     int m_frameParseError;
-    QFileSystemWatcher* m_pFsWatcher;
-
-    bool valuesFormattedProperly(const QStringList& data);
-    bool valueRestrictionsAreMet(const QStringList& data);
-    int getSmallestAcceptedValue(int index, int value);
-    int getLargestAcceptedValue(int index, int value);
+    quint64 m_contentHash;
+    qint64 m_diskSize;
+    qint64 m_diskMtime;
+    bool m_bMatchesDisk;
+    bool m_bRemoteWriter;
+    quint64 m_version;
+    quint64 m_publishedVersion;
+    SnapshotSlot m_snapshot;
+    bool m_bFollowTail;
+    bool m_bTailValid;
+    bool m_bPartialLine;
+    qint64 m_loadedBytes;
+    qint64 m_parsedBytes;
+    QByteArray m_tailSignature;
+
+    void writeCell(int rowIdx, int colIdx, int value);
+    inline void markChanged() { m_version++; }
+    void publishSnapshot();
+    void captureTail();
     bool ableToDiscernCentering(int value);
     void clearData();
-
-    const QVector<int> BUTTON_COL_IDXS{ 0, 1, 2 };
-    const int DPAD_COL_IDX = 5;
+    void saveSnapshot(quint64 hash);
 };
 
@@ -1,5 +1,10 @@
 #include "InputFileModel.h"
 
+#include "ContentHash.h"
+#include "Trace.h"
+#include "RkgFile.h"
+#include "TtkbFile.h"
+
 #include <iostream>
 #include <fstream>
 
@@ -11,6 +16,7 @@ InputFileModel::InputFileModel(InputFile* pFile, QObject* parent)
     : QAbstractTableModel(parent)
     , m_pFile(pFile)
     , m_bCellClicked(false)
+    , m_cursorRow(-1)
 {
 }
 
@@ -18,21 +24,12 @@ Qt::ItemFlags InputFileModel::flags(const QModelIndex& index) const
 {
     Qt::ItemFlags flags = QAbstractItemModel::flags(index);
 
-    switch (index.column())
-    {
-    case 0:
+    int col = index.column() - FRAMECOUNT_COLUMN;
+
+    if (col < 0 || col >= NUM_INPUT_COLUMNS || isPreviewingHistory())
         return flags;
-    case 1:
-    case 2:
-    case 3:
-        return flags |= Qt::ItemIsUserCheckable;
-    case 4:
-    case 5:
-    case 6:
-        return flags |= Qt::ItemIsEditable;
-    }
 
-    return flags;
+    return flags | (isButtonColumn(col) ? Qt::ItemIsUserCheckable : Qt::ItemIsEditable);
 }
 
 int InputFileModel::rowCount(const QModelIndex& /*parent*/) const
@@ -53,22 +50,24 @@ QVariant InputFileModel::data(const QModelIndex& index, int role) const
         {
             if (index.column() == 0)
                 return QString::number(index.row() + 1);
-            if (index.column() < 4)
+            if (isButtonColumn(index.column() - FRAMECOUNT_COLUMN))
                 return QVariant();
 
-            return m_pFile->getCellValue(index.row(), index.column() - FRAMECOUNT_COLUMN);
+            return QString::number(shownValue(index.row(), index.column() - FRAMECOUNT_COLUMN));
         }
     case Qt::CheckStateRole:
         {
-            if (index.column() == 0 || index.column() > 3)
+            if (index.column() == 0 || !isButtonColumn(index.column() - FRAMECOUNT_COLUMN))
                 return QVariant();
 
-            QString value = m_pFile->getCellValue(index.row(), index.column() - FRAMECOUNT_COLUMN);
-            return (value == "1") ? Qt::Checked : Qt::Unchecked;
+            int value = shownValue(index.row(), index.column() - FRAMECOUNT_COLUMN);
+            return (value == 1) ? Qt::Checked : Qt::Unchecked;
         }
     case Qt::TextAlignmentRole:
         return Qt::AlignCenter;
     case Qt::BackgroundRole:
+        if (index.row() == m_cursorRow)
+            return QBrush(QColor(255, 220, 120));
         return index.column() == 0 ? QBrush(Qt::gray) : QVariant();
     }
         
@@ -79,23 +78,10 @@ QVariant InputFileModel::headerData(int section, Qt::Orientation orientation, in
 {
     if (role == Qt::DisplayRole && orientation == Qt::Horizontal)
     {
-        switch (section)
-        {
-        case 0:
+        if (section == 0)
             return QString("Frame");
-        case 1:
-            return QString("A");
-        case 2:
-            return QString("B");
-        case 3:
-            return QString("L");
-        case 4:
-            return QString("LR");
-        case 5:
-            return QString("UD");
-        case 6:
-            return QString("DPad");
-        }
+        if (section < NUM_INPUT_COLUMNS + FRAMECOUNT_COLUMN)
+            return QString(TTK_COLUMNS[section - FRAMECOUNT_COLUMN].name);
     }
 
     return QVariant();
@@ -103,7 +89,10 @@ QVariant InputFileModel::headerData(int section, Qt::Orientation orientation, in
 
 bool InputFileModel::setData(const QModelIndex& index, const QVariant& value, int role)
 {
-    if (!checkIndex(index))
+    TTK_TRACE_SCOPE("setData");
+
+    // The history preview is read-only
+    if (!checkIndex(index) || isPreviewingHistory())
         return false;
 
     QString prevValue = m_pFile->getCellValue(index.row(), index.column() - FRAMECOUNT_COLUMN);
@@ -127,6 +116,7 @@ bool InputFileModel::setData(const QModelIndex& index, const QVariant& value, in
             return false;
 
         curValue = value.toString();
+        TTK_TRACE_EDIT_START();
     }
 
     setCachedFileData(index.row(), index.column() - FRAMECOUNT_COLUMN, curValue);
@@ -134,10 +124,173 @@ bool InputFileModel::setData(const QModelIndex& index, const QVariant& value, in
     writeFileOnDisk(m_pFile);
 
     m_pFile->getTableView()->viewport()->update();
+    emit dataChanged(index, index);
+    emit cellEdited(index.row(), index.column() - FRAMECOUNT_COLUMN, curValue.toInt());
 
     return false;
 }
 
+int InputFileModel::applyFrames(int firstRow, const TtkFrame* pFrames, int count)
+{
+    TTK_TRACE_SCOPE("applyFrames");
+
+    const TtkFileData& data = m_pFile->getData();
+    QVector<CellEditAction> edits;
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            int prev = data[firstRow + i].values[col];
+            int cur = pFrames[i].values[col];
+
+            // Every cell after the first is linked so the whole change is one undo step
+            if (prev != cur)
+                edits.append(CellEditAction(firstRow + i, col, prev, cur, !edits.isEmpty()));
+        }
+    }
+
+    if (edits.isEmpty())
+        return 0;
+
+    m_pFile->applyEdits(edits);
+
+    m_pFile->getRedoStack()->clear();
+    for (const CellEditAction& edit : edits)
+        m_pFile->getUndoStack()->push(edit);
+
+    updateActionMenus();
+    writeFileOnDisk(m_pFile);
+
+    emit dataChanged(index(firstRow, FRAMECOUNT_COLUMN), index(firstRow + count - 1, columnCount() - 1));
+    emit framesEdited(firstRow, count);
+
+    return edits.count();
+}
+
+TailStatus InputFileModel::followAppends()
+{
+    AppendedFrames appended;
+    TailStatus status = m_pFile->readAppended(&appended);
+
+    if (status != TailStatus::Appended)
+        return status;
+
+    int prevCount = rowCount();
+    Centering prevCentering = m_pFile->getCentering();
+    int newRows = appended.frames.count() - (appended.bReplacesLast ? 1 : 0);
+
+    if (newRows > 0)
+        beginInsertRows(QModelIndex(), prevCount, prevCount + newRows - 1);
+
+    m_pFile->adoptAppended(appended);
+
+    if (newRows > 0)
+        endInsertRows();
+
+    // The file's last line was unfinished when read and is now complete
+    if (appended.bReplacesLast)
+        emit dataChanged(index(prevCount - 1, FRAMECOUNT_COLUMN), index(prevCount - 1, columnCount() - 1));
+
+    if (m_pFile->getCentering() != prevCentering)
+        emit centeringChanged();
+
+    return status;
+}
+
+void InputFileModel::beginHistoryPreview()
+{
+    TTK_TRACE_SCOPE("historyBuild");
+    m_timeline.build(m_pFile->getData(), *m_pFile->getUndoStack(), *m_pFile->getRedoStack(), m_pFile->getVersion());
+}
+
+bool InputFileModel::isHistoryPreviewCurrent() const
+{
+    // Anything that changed the file since the timeline was built may also have changed its history
+    return m_timeline.isCurrentFor(m_pFile->getVersion());
+}
+
+int InputFileModel::previewHistoryStep(int step)
+{
+    TTK_TRACE_SCOPE("historySeek");
+
+    int rowIdx = m_timeline.seek(step);
+    emitAllCellsChanged();
+    return rowIdx;
+}
+
+QVector<CellEditAction> InputFileModel::restoreHistoryPreview()
+{
+    TTK_TRACE_SCOPE("historyRestore");
+
+    QVector<CellEditAction> moved;
+    if (!isHistoryPreviewCurrent())
+        return moved;
+
+    TtkStack* pUndoStack = m_pFile->getUndoStack();
+    TtkStack* pRedoStack = m_pFile->getRedoStack();
+
+    for (int step = m_timeline.fileStep(); step > m_timeline.previewStep(); step--)
+        pUndoStack->moveTopGroup(pRedoStack, &moved);
+    for (int step = m_timeline.fileStep(); step < m_timeline.previewStep(); step++)
+        pRedoStack->moveTopGroup(pUndoStack, &moved);
+
+    m_timeline.clear();
+
+    if (!moved.isEmpty())
+    {
+        m_pFile->applyEdits(moved);
+        updateActionMenus();
+        writeFileOnDisk(m_pFile);
+    }
+
+    emitAllCellsChanged();
+    return moved;
+}
+
+void InputFileModel::endHistoryPreview()
+{
+    if (!isPreviewingHistory())
+        return;
+
+    m_timeline.clear();
+    emitAllCellsChanged();
+}
+
+int InputFileModel::shownValue(int rowIdx, int colIdx) const
+{
+    // The preview is empty unless one is shown, and rows appended since it was built are live
+    const TtkFileData& preview = m_timeline.preview();
+    if (rowIdx < preview.count())
+        return preview[rowIdx].values[colIdx];
+
+    return m_pFile->getCellNumber(rowIdx, colIdx);
+}
+
+void InputFileModel::emitAllCellsChanged()
+{
+    if (rowCount() > 0)
+        emit dataChanged(index(0, FRAMECOUNT_COLUMN), index(rowCount() - 1, columnCount() - 1));
+}
+
+void InputFileModel::setCursorRow(int row)
+{
+    if (row >= rowCount())
+        row = -1;
+
+    if (row == m_cursorRow)
+        return;
+
+    // Only the rows losing and gaining the highlight are repainted
+    int prevRow = m_cursorRow;
+    m_cursorRow = row;
+
+    if (prevRow >= 0)
+        emit dataChanged(index(prevRow, 0), index(prevRow, columnCount() - 1), { Qt::BackgroundRole });
+    if (row >= 0)
+        emit dataChanged(index(row, 0), index(row, columnCount() - 1), { Qt::BackgroundRole });
+}
+
 void InputFileModel::updateActionMenus()
 {
     m_pFile->getMenus().undo->setEnabled(m_pFile->getUndoStack()->count() > 0);
@@ -149,7 +302,7 @@ void InputFileModel::addToStack(CellEditAction action)
     if (m_pFile->getRedoStack()->count() > 0)
         addToStackWithNonEmptyRedo(action);
     else
-        m_pFile->getUndoStack()->append(action);
+        m_pFile->getUndoStack()->push(action);
     
     updateActionMenus();
 }
@@ -159,8 +312,8 @@ void InputFileModel::addToStackWithNonEmptyRedo(CellEditAction action)
     CellEditAction redoTop = m_pFile->getRedoStack()->top();
     redoTop.flipValues();
 
-    // Scenario 1: user performs same action as in top of redo stack
-    if (action == redoTop)
+    // Scenario 1: user performs same action as in top of redo stack (and it isn't part of a transaction)
+    if (action == redoTop && !redoTop.isLinked())
         m_pFile->getRedoStack()->pop();
     // Scenario 2: user performs action not in redo stack, so clear it first
     else
@@ -176,27 +329,44 @@ void InputFileModel::setCachedFileData(int rowIdx, int colIdx, QString val)
 
 void InputFileModel::writeFileOnDisk(InputFile* pInputFile)
 {
-    std::ofstream file;
-    file.open(pInputFile->getPath().toStdString());
+    TTK_TRACE_SCOPE("save");
 
-    // Iterate across the data frame-by-frame to write a new line
-    const TtkFileData& data = pInputFile->getData();
+    // Another editor instance sharing this file over the edit bus writes it
+    if (pInputFile->hasRemoteWriter())
+        return;
 
-    for (int i = 0; i < data.count(); i++)
+    quint64 hash = 0;
+    if (writeFrames(pInputFile->getPath(), pInputFile->getData(), pInputFile->getCentering(), &hash))
     {
-        std::string frameData = "";
+        pInputFile->noteWrittenToDisk(hash);
+        emit ((InputFileModel*) pInputFile->getTableView()->model())->fileWritten(hash);
+    }
 
-        for (int j = 0; j < NUM_INPUT_COLUMNS; j++)
-        {
-            frameData += data[i][j].toStdString();
-            frameData += ",";
-        }
+    TTK_TRACE_EDIT_ON_DISK();
+}
 
-        frameData.pop_back();
+bool InputFileModel::writeFrames(const QString& path, const TtkFileData& data, Centering centering, quint64* pContentHash)
+{
+    // Binary files are identified by the checksum in their header, CSVs by a hash of their bytes
+    if (TtkbFile::isTtkbPath(path))
+        return TtkbFile::save(path, data, centering) && (pContentHash == nullptr || TtkbFile::readChecksum(path, pContentHash));
+    if (RkgFile::isRkgPath(path))
+        return RkgFile::save(path, data, centering) && (pContentHash == nullptr || RkgFile::readChecksum(path, pContentHash));
 
-        file << frameData;
-        file << "\n";
-    }
+    std::ofstream file;
+    file.open(path.toStdString());
+
+    if (!file.is_open())
+        return false;
+
+    // Format every frame in one pass and hand the whole file to the stream at once
+    QByteArray csv;
+    appendCsvLines(data.constData(), data.count(), &csv);
+    file.write(csv.constData(), csv.size());
+
+    if (pContentHash != nullptr)
+        *pContentHash = contentHash(csv.constData(), csv.size());
 
     file.close();
+    return !file.fail();
 }
\ No newline at end of file
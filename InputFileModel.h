@@ -1,5 +1,6 @@
 #pragma once
 
+#include "HistoryTimeline.h"
 #include "InputFile.h"
 
 #include <QAbstractTableModel>
@@ -17,14 +18,48 @@ public:
     bool setData(const QModelIndex& index, const QVariant& value, int role) override;
 
     static void writeFileOnDisk(InputFile* pInputFile);
+    static bool writeFrames(const QString& path, const TtkFileData& data, Centering centering, quint64* pContentHash = nullptr);
     void inline setCellClicked(bool bClicked) { m_bCellClicked = bClicked; }
+    void setCursorRow(int row);
+    inline int getCursorRow() const { return m_cursorRow; }
+    int applyFrames(int firstRow, const TtkFrame* pFrames, int count);
+
+    // Reads what was appended to a followed file, inserting the new rows
+    TailStatus followAppends();
+
+    // Shows a past state from the undo history read-only in place of the file. Restoring it
+    // moves the stacks there as that many undos or redos would, but applies and saves once.
+    void beginHistoryPreview();
+    bool isHistoryPreviewCurrent() const;
+    inline bool isPreviewingHistory() const { return m_timeline.isBuilt(); }
+    inline const HistoryTimeline& getTimeline() const { return m_timeline; }
+    int previewHistoryStep(int step);
+    QVector<CellEditAction> restoreHistoryPreview();
+    void endHistoryPreview();
+
+signals:
+    // An interactive edit of one cell (not transforms, macros or undo)
+    void cellEdited(int rowIdx, int colIdx, int value);
+
+    // Frames changed as one transaction (transforms, macros)
+    void framesEdited(int firstRow, int count);
+
+    // Appended rows revealed the file's centering
+    void centeringChanged();
+
+    // The file was saved; the hash identifies what is on disk now
+    void fileWritten(quint64 contentHash);
 
 private:
     void inline setCachedFileData(int rowIdx, int colIdx, QString val);
     void addToStack(CellEditAction action);
     void addToStackWithNonEmptyRedo(CellEditAction action);
     void updateActionMenus();
+    int shownValue(int rowIdx, int colIdx) const;
+    void emitAllCellsChanged();
 
     InputFile* m_pFile;
     bool m_bCellClicked;
+    int m_cursorRow;
+    HistoryTimeline m_timeline;
 };
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "InputPlot.h"
+
+#include "InputFile.h"
+
+#include <QPainter>
+#include <QPainterPath>
+
+#include <cstring>
+
+#define STICK_GRID_MIN -7
+#define STICK_GRID_SIZE 22
+#define TRAJECTORY_MARGIN 6
+#define NUM_BUTTON_LANES 4
+#define BUTTON_LANE_HEIGHT 8
+#define LANE_GAP 3
+
+static const QColor BUTTON_COLOR(40, 90, 200);
+static const QColor STICK_COLOR(30, 150, 60);
+static const QColor DPAD_COLOR(210, 120, 20);
+static const QColor GUIDE_COLOR(200, 200, 200);
+
+static inline int stickCell(int lr, int ud)
+{
+    lr = qBound(0, lr - STICK_GRID_MIN, STICK_GRID_SIZE - 1);
+    ud = qBound(0, ud - STICK_GRID_MIN, STICK_GRID_SIZE - 1);
+    return lr * STICK_GRID_SIZE + ud;
+}
+
+InputPlot::InputPlot(QWidget* parent)
+    : QWidget(parent)
+    , m_pFile(nullptr)
+    , m_firstRow(0)
+    , m_lastRow(-1)
+    , m_bBucketsValid(false)
+{
+    setFixedHeight(PLOT_PANEL_HEIGHT);
+}
+
+void InputPlot::setFile(InputFile* pInputFile)
+{
+    m_pFile = pInputFile;
+    m_firstRow = 0;
+    m_lastRow = -1;
+    invalidate();
+}
+
+void InputPlot::setRange(int firstRow, int lastRow)
+{
+    if (firstRow == m_firstRow && lastRow == m_lastRow)
+        return;
+
+    m_firstRow = firstRow;
+    m_lastRow = lastRow;
+    invalidate();
+}
+
+void InputPlot::invalidate()
+{
+    m_bBucketsValid = false;
+    update();
+}
+
+void InputPlot::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    m_bBucketsValid = false;
+}
+
+int InputPlot::timelineWidth() const
+{
+    return qMax(1, width() - height() - TRAJECTORY_MARGIN);
+}
+
+int InputPlot::bucketStart(int bucketIdx) const
+{
+    qint64 count = m_lastRow - m_firstRow + 1;
+    return m_firstRow + static_cast<int>(bucketIdx * count / m_buckets.count());
+}
+
+int InputPlot::bucketOf(int rowIdx) const
+{
+    qint64 count = m_lastRow - m_firstRow + 1;
+    int bucketIdx = static_cast<int>((rowIdx - m_firstRow) * static_cast<qint64>(m_buckets.count()) / count);
+
+    // Bucket edges round down, so the estimate can be one off either way
+    while (bucketIdx > 0 && bucketStart(bucketIdx) > rowIdx)
+        bucketIdx--;
+    while (bucketIdx + 1 < m_buckets.count() && bucketStart(bucketIdx + 1) <= rowIdx)
+        bucketIdx++;
+
+    return bucketIdx;
+}
+
+void InputPlot::computeBucket(int bucketIdx)
+{
+    const TtkFileData& data = m_pFile->getData();
+    PlotBucket& bucket = m_buckets[bucketIdx];
+
+    memset(&bucket, 0, sizeof(bucket));
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+    {
+        bucket.minValue[col] = 127;
+        bucket.maxValue[col] = -128;
+    }
+
+    // The range is only clamped to the file on a rebuild, and the file can shrink before that
+    int endRow = qMin(bucketStart(bucketIdx + 1), data.count());
+
+    for (int row = bucketStart(bucketIdx); row < endRow; row++)
+    {
+        const TtkFrame& frame = data[row];
+
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            bucket.minValue[col] = qMin(bucket.minValue[col], frame.values[col]);
+            bucket.maxValue[col] = qMax(bucket.maxValue[col], frame.values[col]);
+        }
+
+        bucket.sumLR += frame.values[3];
+        bucket.sumUD += frame.values[4];
+
+        int cell = stickCell(frame.values[3], frame.values[4]);
+        bucket.stickCells[cell / 32] |= 1u << (cell % 32);
+    }
+}
+
+void InputPlot::rebuildBuckets()
+{
+    m_bBucketsValid = true;
+
+    int frameCount = (m_pFile == nullptr) ? 0 : m_pFile->getData().count();
+    m_lastRow = qMin(m_lastRow, frameCount - 1);
+
+    int count = m_lastRow - m_firstRow + 1;
+    if (count <= 0 || m_firstRow < 0)
+    {
+        m_buckets.clear();
+        return;
+    }
+
+    m_buckets.resize(qMin(count, timelineWidth()));
+
+    for (int i = 0; i < m_buckets.count(); i++)
+        computeBucket(i);
+}
+
+void InputPlot::rowsChanged(int firstRow, int lastRow)
+{
+    if (!m_bBucketsValid || m_buckets.isEmpty())
+        return;
+
+    firstRow = qMax(firstRow, m_firstRow);
+    lastRow = qMin(lastRow, qMin(m_lastRow, m_pFile->getData().count() - 1));
+
+    if (firstRow > lastRow)
+        return;
+
+    int lastBucket = bucketOf(lastRow);
+    for (int i = bucketOf(firstRow); i <= lastBucket; i++)
+        computeBucket(i);
+
+    update();
+}
+
+void InputPlot::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    if (!m_bBucketsValid)
+        rebuildBuckets();
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(Qt::white));
+
+    if (m_buckets.isEmpty())
+        return;
+
+    drawTrajectory(&painter, QRect(0, 0, height(), height()));
+    drawTimeline(&painter, QRect(height() + TRAJECTORY_MARGIN, 0, timelineWidth(), height()));
+}
+
+void InputPlot::drawTrajectory(QPainter* pPainter, const QRect& area)
+{
+    int minValue, maxValue;
+    valueBounds(3, m_pFile->getCentering(), &minValue, &maxValue);
+
+    int cells = maxValue - minValue + 1;
+    double cellSize = static_cast<double>(area.width()) / cells;
+
+    // How many buckets visited each stick position
+    int visits[STICK_GRID_SIZE * STICK_GRID_SIZE];
+    memset(visits, 0, sizeof(visits));
+    int maxVisits = 1;
+
+    for (const PlotBucket& bucket : m_buckets)
+    {
+        for (int cell = 0; cell < STICK_GRID_SIZE * STICK_GRID_SIZE; cell++)
+        {
+            if (bucket.stickCells[cell / 32] & (1u << (cell % 32)))
+                maxVisits = qMax(maxVisits, ++visits[cell]);
+        }
+    }
+
+    pPainter->setPen(Qt::NoPen);
+
+    for (int lr = minValue; lr <= maxValue; lr++)
+    {
+        for (int ud = minValue; ud <= maxValue; ud++)
+        {
+            int count = visits[stickCell(lr, ud)];
+            if (count == 0)
+                continue;
+
+            QColor shade = STICK_COLOR;
+            shade.setAlpha(60 + 195 * count / maxVisits);
+            pPainter->fillRect(QRectF(area.left() + (lr - minValue) * cellSize, area.top() + (maxValue - ud) * cellSize, cellSize, cellSize), shade);
+        }
+    }
+
+    int neutral = (m_pFile->getCentering() == Centering::Seven) ? 7 : 0;
+    double centerX = area.left() + (neutral - minValue + 0.5) * cellSize;
+    double centerY = area.top() + (maxValue - neutral + 0.5) * cellSize;
+
+    pPainter->setPen(GUIDE_COLOR);
+    pPainter->drawLine(QLineF(centerX, area.top(), centerX, area.bottom()));
+    pPainter->drawLine(QLineF(area.left(), centerY, area.right(), centerY));
+    pPainter->drawRect(area.adjusted(0, 0, -1, -1));
+
+    // The trajectory through each bucket's average position, drawn as one path
+    QPainterPath path;
+
+    for (int i = 0; i < m_buckets.count(); i++)
+    {
+        int frames = bucketStart(i + 1) - bucketStart(i);
+        double x = area.left() + (static_cast<double>(m_buckets[i].sumLR) / frames - minValue + 0.5) * cellSize;
+        double y = area.top() + (maxValue - static_cast<double>(m_buckets[i].sumUD) / frames + 0.5) * cellSize;
+
+        if (i == 0)
+            path.moveTo(x, y);
+        else
+            path.lineTo(x, y);
+    }
+
+    pPainter->setPen(QColor(Qt::black));
+    pPainter->setBrush(Qt::NoBrush);
+    pPainter->drawPath(path);
+}
+
+void InputPlot::drawTimeline(QPainter* pPainter, const QRect& area)
+{
+    int numBuckets = m_buckets.count();
+    auto bucketLeft = [&](int i) { return area.left() + static_cast<int>(static_cast<qint64>(i) * area.width() / numBuckets); };
+
+    // Buttons and DPad: one rect per run of buckets where the input is held at all
+    for (int lane = 0; lane < NUM_BUTTON_LANES; lane++)
+    {
+        int col = (lane < 3) ? lane : 5;
+        int top = area.top() + lane * (BUTTON_LANE_HEIGHT + LANE_GAP);
+        QVector<QRect> runs;
+
+        for (int i = 0; i < numBuckets; )
+        {
+            if (m_buckets[i].maxValue[col] == 0 && m_buckets[i].minValue[col] == 0)
+            {
+                i++;
+                continue;
+            }
+
+            int end = i;
+            while (end + 1 < numBuckets && (m_buckets[end + 1].maxValue[col] != 0 || m_buckets[end + 1].minValue[col] != 0))
+                end++;
+
+            runs.append(QRect(bucketLeft(i), top, qMax(1, bucketLeft(end + 1) - bucketLeft(i)), BUTTON_LANE_HEIGHT));
+            i = end + 1;
+        }
+
+        pPainter->setPen(Qt::NoPen);
+        pPainter->setBrush((lane < 3) ? BUTTON_COLOR : DPAD_COLOR);
+        pPainter->drawRects(runs);
+    }
+
+    // Sticks: a min/max bar per bucket, stretched to meet its neighbour so the trace stays connected
+    int minValue, maxValue;
+    valueBounds(3, m_pFile->getCentering(), &minValue, &maxValue);
+
+    int stickTop = area.top() + NUM_BUTTON_LANES * (BUTTON_LANE_HEIGHT + LANE_GAP);
+    int laneHeight = (area.bottom() - stickTop - LANE_GAP) / 2;
+
+    for (int col = 3; col <= 4; col++)
+    {
+        int top = stickTop + (col - 3) * (laneHeight + LANE_GAP);
+        auto yFor = [&](int value) { return top + (maxValue - value) * (laneHeight - 1) / qMax(1, maxValue - minValue); };
+        QVector<QRect> bars;
+
+        for (int i = 0; i < numBuckets; i++)
+        {
+            int lo = m_buckets[i].minValue[col];
+            int hi = m_buckets[i].maxValue[col];
+
+            if (i > 0)
+            {
+                lo = qMin(lo, static_cast<int>(m_buckets[i - 1].maxValue[col]));
+                hi = qMax(hi, static_cast<int>(m_buckets[i - 1].minValue[col]));
+            }
+
+            bars.append(QRect(bucketLeft(i), yFor(hi), qMax(1, bucketLeft(i + 1) - bucketLeft(i)), yFor(lo) - yFor(hi) + 1));
+        }
+
+        pPainter->setPen(Qt::NoPen);
+        pPainter->fillRect(QRect(area.left(), top, area.width(), laneHeight), QColor(245, 245, 245));
+        pPainter->setBrush(STICK_COLOR);
+        pPainter->drawRects(bars);
+    }
+}
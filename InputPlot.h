@@ -0,0 +1,58 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QWidget>
+
+#define PLOT_PANEL_HEIGHT 130
+
+class InputFile;
+class QPaintEvent;
+class QResizeEvent;
+
+// Plots a range of frames: on the left the stick positions visited (shaded by how often) with
+// the decimated trajectory through them, on the right a timeline of button, DPad and stick lanes.
+// The range is split into at most one bucket per timeline pixel column and each bucket keeps the
+// min/max of every column, so drawing depends on the widget size and not on the frame count.
+// Edits only recompute the buckets holding the changed rows.
+class InputPlot : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit InputPlot(QWidget* parent = nullptr);
+
+    void setFile(InputFile* pInputFile);
+    void setRange(int firstRow, int lastRow);
+    void rowsChanged(int firstRow, int lastRow);
+    void invalidate();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    // Stick cells cover -7..14 on both axes, whatever the centering
+    struct PlotBucket
+    {
+        qint8 minValue[NUM_INPUT_COLUMNS];
+        qint8 maxValue[NUM_INPUT_COLUMNS];
+        qint32 sumLR;
+        qint32 sumUD;
+        quint32 stickCells[16];
+    };
+
+    InputFile* m_pFile;
+    int m_firstRow;
+    int m_lastRow;
+    QVector<PlotBucket> m_buckets;
+    bool m_bBucketsValid;
+
+    int timelineWidth() const;
+    int bucketStart(int bucketIdx) const;
+    int bucketOf(int rowIdx) const;
+    void computeBucket(int bucketIdx);
+    void rebuildBuckets();
+    void drawTrajectory(QPainter* pPainter, const QRect& area);
+    void drawTimeline(QPainter* pPainter, const QRect& area);
+};
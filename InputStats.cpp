@@ -0,0 +1,205 @@
+#include "InputStats.h"
+
+#include <cstring>
+
+#define STATS_BLOCK_FRAMES 64
+#define NUM_VALUE_TREES (NUM_INPUT_COLUMNS * STATS_NUM_VALUES)
+#define NUM_TREES (NUM_VALUE_TREES + NUM_INPUT_COLUMNS)
+
+static inline int valueTree(int col, int value)
+{
+    int bucket = qBound(0, value - STATS_MIN_VALUE, STATS_NUM_VALUES - 1);
+    return col * STATS_NUM_VALUES + bucket;
+}
+
+static inline int pressTree(int col)
+{
+    return NUM_VALUE_TREES + col;
+}
+
+bool isPress(const TtkFileData& data, int row, int col)
+{
+    int value = data[row].values[col];
+    return value != 0 && (row == 0 || data[row - 1].values[col] != value);
+}
+
+InputStats::InputStats()
+    : m_numBlocks(0)
+{
+}
+
+void InputStats::clear()
+{
+    m_numBlocks = 0;
+    m_trees.clear();
+    m_trees.squeeze();
+}
+
+void InputStats::rebuild(const TtkFileData& data, int reserveFrames)
+{
+    // Blocks past the end of the data count nothing until frames are appended into them
+    m_numBlocks = (qMax(data.count(), reserveFrames) + STATS_BLOCK_FRAMES - 1) / STATS_BLOCK_FRAMES;
+    m_trees.fill(0, NUM_TREES * (m_numBlocks + 1));
+
+    // Count each block in place, then turn every array into a Fenwick tree in O(blocks)
+    for (int row = 0; row < data.count(); row++)
+    {
+        int node = row / STATS_BLOCK_FRAMES + 1;
+
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            tree(valueTree(col, data[row].values[col]))[node]++;
+
+            if (isPress(data, row, col))
+                tree(pressTree(col))[node]++;
+        }
+    }
+
+    for (int t = 0; t < NUM_TREES; t++)
+    {
+        quint32* pTree = tree(t);
+
+        for (int i = 1; i <= m_numBlocks; i++)
+        {
+            int parent = i + (i & -i);
+            if (parent <= m_numBlocks)
+                pTree[parent] += pTree[i];
+        }
+    }
+}
+
+void InputStats::append(const TtkFileData& data, int firstRow)
+{
+    // Out of room: rebuild with twice the frames, so appending stays O(log n) per frame amortized
+    if (data.count() > m_numBlocks * STATS_BLOCK_FRAMES)
+    {
+        rebuild(data, 2 * data.count());
+        return;
+    }
+
+    for (int row = firstRow; row < data.count(); row++)
+    {
+        int block = row / STATS_BLOCK_FRAMES;
+
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            add(valueTree(col, data[row].values[col]), block, 1);
+
+            if (isPress(data, row, col))
+                add(pressTree(col), block, 1);
+        }
+    }
+}
+
+void InputStats::add(int treeIdx, int block, int delta)
+{
+    quint32* pTree = tree(treeIdx);
+
+    for (int i = block + 1; i <= m_numBlocks; i += i & -i)
+        pTree[i] += delta;
+}
+
+quint32 InputStats::prefix(int treeIdx, int blockCount) const
+{
+    const quint32* pTree = tree(treeIdx);
+    quint32 sum = 0;
+
+    for (int i = blockCount; i > 0; i -= i & -i)
+        sum += pTree[i];
+
+    return sum;
+}
+
+quint32 InputStats::blockRange(int treeIdx, int firstBlock, int lastBlock) const
+{
+    return prefix(treeIdx, lastBlock + 1) - prefix(treeIdx, firstBlock);
+}
+
+void InputStats::update(const TtkFileData& data, int row, int col, int prevValue)
+{
+    if (m_numBlocks == 0)
+        return;
+
+    int block = row / STATS_BLOCK_FRAMES;
+    int value = data[row].values[col];
+
+    if (value == prevValue)
+        return;
+
+    add(valueTree(col, prevValue), block, -1);
+    add(valueTree(col, value), block, 1);
+
+    // The change can start or end a press on this frame and on the next one
+    bool bWasPress = prevValue != 0 && (row == 0 || data[row - 1].values[col] != prevValue);
+    updatePress(data, row, col, bWasPress);
+
+    if (row + 1 < data.count())
+    {
+        int nextValue = data[row + 1].values[col];
+        updatePress(data, row + 1, col, nextValue != 0 && nextValue != prevValue);
+    }
+}
+
+void InputStats::updatePress(const TtkFileData& data, int row, int col, bool bWasPress)
+{
+    bool bIsPress = isPress(data, row, col);
+
+    if (bIsPress != bWasPress)
+        add(pressTree(col), row / STATS_BLOCK_FRAMES, bIsPress ? 1 : -1);
+}
+
+void InputStats::scanRows(const TtkFileData& data, int firstRow, int lastRow, int col, ColumnStats* pStats) const
+{
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        pStats->histogram[valueTree(col, data[row].values[col]) - col * STATS_NUM_VALUES]++;
+
+        if (isPress(data, row, col))
+            pStats->presses++;
+    }
+}
+
+ColumnStats InputStats::query(const TtkFileData& data, int firstRow, int lastRow, int col) const
+{
+    ColumnStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    if (firstRow > lastRow || m_numBlocks == 0)
+        return stats;
+
+    int firstBlock = firstRow / STATS_BLOCK_FRAMES;
+    int lastBlock = lastRow / STATS_BLOCK_FRAMES;
+
+    if (lastBlock - firstBlock < 2)
+    {
+        scanRows(data, firstRow, lastRow, col, &stats);
+    }
+    else
+    {
+        // Ragged ends are scanned, whole blocks in between come from the trees
+        scanRows(data, firstRow, (firstBlock + 1) * STATS_BLOCK_FRAMES - 1, col, &stats);
+        scanRows(data, lastBlock * STATS_BLOCK_FRAMES, lastRow, col, &stats);
+
+        for (int i = 0; i < STATS_NUM_VALUES; i++)
+            stats.histogram[i] += blockRange(col * STATS_NUM_VALUES + i, firstBlock + 1, lastBlock - 1);
+
+        stats.presses += blockRange(pressTree(col), firstBlock + 1, lastBlock - 1);
+    }
+
+    stats.minValue = STATS_MIN_VALUE + STATS_NUM_VALUES;
+    stats.maxValue = STATS_MIN_VALUE - 1;
+
+    for (int i = 0; i < STATS_NUM_VALUES; i++)
+    {
+        if (stats.histogram[i] == 0)
+            continue;
+
+        int value = STATS_MIN_VALUE + i;
+        stats.frames += stats.histogram[i];
+        stats.sum += static_cast<qint64>(value) * stats.histogram[i];
+        stats.minValue = qMin(stats.minValue, value);
+        stats.maxValue = qMax(stats.maxValue, value);
+    }
+
+    return stats;
+}
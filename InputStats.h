@@ -0,0 +1,59 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+// Stick values span -7..14 across both centerings; every column is bucketed on that range
+#define STATS_MIN_VALUE -7
+#define STATS_NUM_VALUES 22
+
+struct ColumnStats
+{
+    int frames;
+    qint64 sum;
+    int presses;
+    int minValue;
+    int maxValue;
+    int histogram[STATS_NUM_VALUES];
+
+    inline int countOf(int value) const { return histogram[value - STATS_MIN_VALUE]; }
+};
+
+// Per-column value histograms and press counts over a file, answering any row range in
+// O(log n). Frames are grouped into fixed-size blocks and a Fenwick tree per (column, value)
+// and per column's presses is kept over block counts, which keeps the trees small enough
+// for million-frame files; the partial blocks at either end of a range are read directly.
+// A press is a frame with a non-zero value that differs from the frame before it.
+class InputStats
+{
+public:
+    InputStats();
+
+    void rebuild(const TtkFileData& data, int reserveFrames = 0);
+    void clear();
+
+    // Call after rows from firstRow on were appended to data
+    void append(const TtkFileData& data, int firstRow);
+
+    // Call after data[row].values[col] has changed from prevValue
+    void update(const TtkFileData& data, int row, int col, int prevValue);
+
+    // Rows are inclusive and must be within the data the stats were built from
+    ColumnStats query(const TtkFileData& data, int firstRow, int lastRow, int col) const;
+    inline qint64 memoryUsage() const { return m_trees.capacity() * sizeof(quint32); }
+
+private:
+    int m_numBlocks;
+    QVector<quint32> m_trees;
+
+    inline quint32* tree(int treeIdx) { return m_trees.data() + treeIdx * (m_numBlocks + 1); }
+    inline const quint32* tree(int treeIdx) const { return m_trees.constData() + treeIdx * (m_numBlocks + 1); }
+
+    void add(int treeIdx, int block, int delta);
+    quint32 prefix(int treeIdx, int blockCount) const;
+    quint32 blockRange(int treeIdx, int firstBlock, int lastBlock) const;
+    void scanRows(const TtkFileData& data, int firstRow, int lastRow, int col, ColumnStats* pStats) const;
+    void updatePress(const TtkFileData& data, int row, int col, bool bWasPress);
+};
+
+// True if the frame at row counts as a press in column col
+bool isPress(const TtkFileData& data, int row, int col);
@@ -0,0 +1,545 @@
+#include "RkgFile.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+#define RKG_MAGIC "RKGD"
+#define RKG_HEADER_SIZE 0x88
+#define RKG_CRC_SIZE 4
+#define RKG_FLAGS_OFFSET 0x0C
+#define RKG_COMPRESSED_FLAG 0x08
+#define RKG_INPUT_LENGTH_OFFSET 0x0E
+#define RKG_MII_OFFSET 0x3C
+#define RKG_MII_SIZE 0x4A
+#define RKG_MII_CRC_OFFSET 0x86
+
+// The game's input buffer; uncompressed input data always fills it, zero-padded
+#define RKG_INPUT_BUFFER_SIZE 0x2774
+#define RKG_INPUT_HEADER_SIZE 8
+#define RKG_BUTTON_MASK 0x07
+#define MAX_BUTTON_RUN 0xFF
+#define MAX_DIRECTION_RUN 0xFF
+#define MAX_TRICK_RUN 0xFFF
+#define MAX_STICK_VALUE 14
+#define MAX_DPAD_VALUE 4
+#define NEUTRAL_STICK 7
+
+#define YAZ1_MAGIC "Yaz1"
+#define YAZ1_HEADER_SIZE 16
+#define YAZ1_MIN_MATCH 3
+#define YAZ1_LONG_MATCH 0x12
+#define YAZ1_MAX_MATCH 0x111
+#define YAZ1_WINDOW 0x1000
+#define YAZ1_HASH_BITS 12
+#define YAZ1_MAX_CANDIDATES 64
+
+static inline quint16 readBe16(const uchar* p)
+{
+    return static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+static inline quint32 readBe32(const uchar* p)
+{
+    return (static_cast<quint32>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline void writeBe16(uchar* p, quint16 value)
+{
+    p[0] = static_cast<uchar>(value >> 8);
+    p[1] = static_cast<uchar>(value);
+}
+
+static inline void writeBe32(uchar* p, quint32 value)
+{
+    p[0] = static_cast<uchar>(value >> 24);
+    p[1] = static_cast<uchar>(value >> 16);
+    p[2] = static_cast<uchar>(value >> 8);
+    p[3] = static_cast<uchar>(value);
+}
+
+struct Crc32Table
+{
+    quint32 entries[256];
+
+    Crc32Table()
+    {
+        for (quint32 i = 0; i < 256; i++)
+        {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            entries[i] = c;
+        }
+    }
+};
+
+// CRC-32 as used by zlib and the game for the whole-file checksum
+static quint32 crc32(const uchar* pBytes, qint64 size)
+{
+    // Ghosts can be read on loader threads; a function-local static is built exactly once
+    static const Crc32Table table;
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (qint64 i = 0; i < size; i++)
+        crc = table.entries[(crc ^ pBytes[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// CRC-16/CCITT (XMODEM) the game keeps over the embedded Mii
+static quint16 crc16(const uchar* pBytes, int size)
+{
+    quint16 crc = 0;
+
+    for (int i = 0; i < size; i++)
+    {
+        crc ^= static_cast<quint16>(pBytes[i] << 8);
+        for (int k = 0; k < 8; k++)
+            crc = (crc & 0x8000) ? static_cast<quint16>((crc << 1) ^ 0x1021) : static_cast<quint16>(crc << 1);
+    }
+
+    return crc;
+}
+
+static bool yaz1Decompress(const uchar* pSrc, qint64 srcSize, QByteArray* pOut)
+{
+    if (srcSize < YAZ1_HEADER_SIZE || memcmp(pSrc, YAZ1_MAGIC, 4) != 0)
+        return false;
+
+    // The game never decompresses past its input buffer; anything larger is a crafted header
+    quint32 outSize = readBe32(pSrc + 4);
+    if (outSize > RKG_INPUT_BUFFER_SIZE)
+        return false;
+
+    pOut->resize(static_cast<int>(outSize));
+    uchar* pDst = reinterpret_cast<uchar*>(pOut->data());
+
+    qint64 src = YAZ1_HEADER_SIZE;
+    quint32 dst = 0;
+
+    while (dst < outSize)
+    {
+        if (src >= srcSize)
+            return false;
+
+        uchar code = pSrc[src++];
+
+        for (int bit = 0; bit < 8 && dst < outSize; bit++, code <<= 1)
+        {
+            if (code & 0x80)
+            {
+                if (src >= srcSize)
+                    return false;
+
+                pDst[dst++] = pSrc[src++];
+                continue;
+            }
+
+            if (src + 2 > srcSize)
+                return false;
+
+            uchar b1 = pSrc[src++];
+            uchar b2 = pSrc[src++];
+            quint32 dist = (((b1 & 0x0F) << 8) | b2) + 1;
+            quint32 length = b1 >> 4;
+
+            if (length == 0)
+            {
+                if (src >= srcSize)
+                    return false;
+                length = pSrc[src++] + YAZ1_LONG_MATCH;
+            }
+            else
+            {
+                length += 2;
+            }
+
+            if (dist > dst)
+                return false;
+
+            // Byte by byte, since a match may overlap the bytes it produces
+            length = qMin(length, outSize - dst);
+            for (quint32 i = 0; i < length; i++, dst++)
+                pDst[dst] = pDst[dst - dist];
+        }
+    }
+
+    return true;
+}
+
+static inline int yaz1Hash(const uchar* p)
+{
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & ((1 << YAZ1_HASH_BITS) - 1);
+}
+
+// Greedy LZ over hash chains of 3-byte prefixes. Ghost inputs are a few KB of
+// mostly repeated runs, so a short candidate search gets close to optimal.
+static void yaz1Compress(const uchar* pSrc, int srcSize, QByteArray* pOut)
+{
+    QVector<int> head(1 << YAZ1_HASH_BITS, -1);
+    QVector<int> prev(srcSize, -1);
+
+    pOut->resize(YAZ1_HEADER_SIZE + srcSize + (srcSize + 7) / 8);
+    uchar* pDst = reinterpret_cast<uchar*>(pOut->data());
+    memset(pDst, 0, YAZ1_HEADER_SIZE);
+    memcpy(pDst, YAZ1_MAGIC, 4);
+    writeBe32(pDst + 4, srcSize);
+
+    int dst = YAZ1_HEADER_SIZE;
+    int pos = 0;
+
+    auto insert = [&](int at)
+    {
+        if (at + YAZ1_MIN_MATCH > srcSize)
+            return;
+
+        int h = yaz1Hash(pSrc + at);
+        prev[at] = head[h];
+        head[h] = at;
+    };
+
+    while (pos < srcSize)
+    {
+        int codeIdx = dst++;
+        pDst[codeIdx] = 0;
+
+        for (int bit = 0; bit < 8 && pos < srcSize; bit++)
+        {
+            int bestLength = 0;
+            int bestPos = 0;
+
+            if (pos + YAZ1_MIN_MATCH <= srcSize)
+            {
+                int maxLength = qMin(YAZ1_MAX_MATCH, srcSize - pos);
+                int candidate = head[yaz1Hash(pSrc + pos)];
+
+                for (int tries = 0; candidate >= 0 && pos - candidate <= YAZ1_WINDOW && tries < YAZ1_MAX_CANDIDATES; tries++)
+                {
+                    int length = 0;
+                    while (length < maxLength && pSrc[candidate + length] == pSrc[pos + length])
+                        length++;
+
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestPos = candidate;
+
+                        if (length == maxLength)
+                            break;
+                    }
+
+                    candidate = prev[candidate];
+                }
+            }
+
+            if (bestLength < YAZ1_MIN_MATCH)
+            {
+                pDst[codeIdx] |= 0x80 >> bit;
+                pDst[dst++] = pSrc[pos];
+                insert(pos++);
+                continue;
+            }
+
+            int dist = pos - bestPos - 1;
+
+            if (bestLength >= YAZ1_LONG_MATCH)
+            {
+                pDst[dst++] = static_cast<uchar>(dist >> 8);
+                pDst[dst++] = static_cast<uchar>(dist);
+                pDst[dst++] = static_cast<uchar>(bestLength - YAZ1_LONG_MATCH);
+            }
+            else
+            {
+                pDst[dst++] = static_cast<uchar>(((bestLength - 2) << 4) | (dist >> 8));
+                pDst[dst++] = static_cast<uchar>(dist);
+            }
+
+            for (int i = 0; i < bestLength; i++)
+                insert(pos++);
+        }
+    }
+
+    pOut->resize(dst);
+}
+
+// Expands the three run streams straight into frames, one forward pass over each
+static bool decodeInputs(const uchar* pInputs, qint64 size, TtkFileData* pData)
+{
+    if (size < RKG_INPUT_HEADER_SIZE)
+        return false;
+
+    int faceCount = readBe16(pInputs);
+    int directionCount = readBe16(pInputs + 2);
+    int trickCount = readBe16(pInputs + 4);
+
+    if (RKG_INPUT_HEADER_SIZE + 2 * static_cast<qint64>(faceCount + directionCount + trickCount) > size)
+        return false;
+
+    const uchar* pFace = pInputs + RKG_INPUT_HEADER_SIZE;
+    const uchar* pDirection = pFace + 2 * faceCount;
+    const uchar* pTrick = pDirection + 2 * directionCount;
+
+    // The face button stream sets the length of the run
+    int frameCount = 0;
+    for (int i = 0; i < faceCount; i++)
+        frameCount += pFace[2 * i + 1];
+
+    pData->resize(frameCount);
+    TtkFrame* pFrames = pData->data();
+
+    int row = 0;
+    for (int i = 0; i < faceCount; i++)
+    {
+        int buttons = pFace[2 * i] & RKG_BUTTON_MASK;
+        qint8 a = buttons & 0x01 ? 1 : 0;
+        qint8 b = buttons & 0x02 ? 1 : 0;
+        qint8 l = buttons & 0x04 ? 1 : 0;
+
+        for (int end = row + pFace[2 * i + 1]; row < end; row++)
+        {
+            pFrames[row].values[0] = a;
+            pFrames[row].values[1] = b;
+            pFrames[row].values[2] = l;
+        }
+    }
+
+    row = 0;
+    for (int i = 0; i < directionCount && row < frameCount; i++)
+    {
+        qint8 lr = pDirection[2 * i] >> 4;
+        qint8 ud = pDirection[2 * i] & 0x0F;
+
+        if (lr > MAX_STICK_VALUE || ud > MAX_STICK_VALUE)
+            return false;
+
+        for (int end = qMin(frameCount, row + pDirection[2 * i + 1]); row < end; row++)
+        {
+            pFrames[row].values[3] = lr;
+            pFrames[row].values[4] = ud;
+        }
+    }
+
+    for (; row < frameCount; row++)
+    {
+        pFrames[row].values[3] = NEUTRAL_STICK;
+        pFrames[row].values[4] = NEUTRAL_STICK;
+    }
+
+    row = 0;
+    for (int i = 0; i < trickCount && row < frameCount; i++)
+    {
+        quint16 entry = readBe16(pTrick + 2 * i);
+        qint8 dpad = (entry >> 12) & 0x07;
+
+        if (dpad > MAX_DPAD_VALUE)
+            return false;
+
+        for (int end = qMin(frameCount, row + (entry & MAX_TRICK_RUN)); row < end; row++)
+            pFrames[row].values[5] = dpad;
+    }
+
+    for (; row < frameCount; row++)
+        pFrames[row].values[5] = 0;
+
+    return true;
+}
+
+bool RkgFile::isRkgPath(const QString& path)
+{
+    return path.endsWith(RKG_EXTENSION, Qt::CaseInsensitive);
+}
+
+FileStatus RkgFile::load(const QString& path, TtkFileData* pData, quint64* pChecksum)
+{
+    QFile fp(path);
+    if (!fp.open(QIODevice::ReadOnly))
+        return FileStatus::WritePermission;
+
+    qint64 size = fp.size();
+    uchar* pBytes = size > 0 ? fp.map(0, size) : nullptr;
+
+    if (pBytes == nullptr)
+        return FileStatus::Corrupt;
+
+    FileStatus status = fromMemory(pBytes, size, pData, pChecksum);
+    fp.unmap(pBytes);
+
+    return status;
+}
+
+FileStatus RkgFile::fromMemory(const uchar* pBytes, qint64 size, TtkFileData* pData, quint64* pChecksum)
+{
+    if (size < RKG_HEADER_SIZE + RKG_CRC_SIZE || memcmp(pBytes, RKG_MAGIC, 4) != 0)
+        return FileStatus::Corrupt;
+
+    quint32 crc = readBe32(pBytes + size - RKG_CRC_SIZE);
+    if (crc32(pBytes, size - RKG_CRC_SIZE) != crc)
+        return FileStatus::Corrupt;
+
+    const uchar* pInputs = pBytes + RKG_HEADER_SIZE;
+    qint64 inputSize = size - RKG_HEADER_SIZE - RKG_CRC_SIZE;
+    QByteArray decompressed;
+
+    if (pBytes[RKG_FLAGS_OFFSET] & RKG_COMPRESSED_FLAG)
+    {
+        if (inputSize < 4 || readBe32(pInputs) > inputSize - 4)
+            return FileStatus::Corrupt;
+
+        if (!yaz1Decompress(pInputs + 4, readBe32(pInputs), &decompressed))
+            return FileStatus::Corrupt;
+
+        pInputs = reinterpret_cast<const uchar*>(decompressed.constData());
+        inputSize = decompressed.size();
+    }
+
+    if (!decodeInputs(pInputs, inputSize, pData))
+    {
+        pData->clear();
+        return FileStatus::Corrupt;
+    }
+
+    if (pChecksum != nullptr)
+        *pChecksum = crc;
+
+    return FileStatus::Success;
+}
+
+bool RkgFile::readChecksum(const QString& path, quint64* pChecksum)
+{
+    QFile fp(path);
+    if (!fp.open(QIODevice::ReadOnly) || fp.size() < RKG_HEADER_SIZE + RKG_CRC_SIZE)
+        return false;
+
+    uchar crc[RKG_CRC_SIZE];
+    if (!fp.seek(fp.size() - RKG_CRC_SIZE) || fp.read(reinterpret_cast<char*>(crc), RKG_CRC_SIZE) != RKG_CRC_SIZE)
+        return false;
+
+    *pChecksum = readBe32(crc);
+    return true;
+}
+
+bool RkgFile::encode(const TtkFrame* pFrames, int count, Centering centering, const QByteArray& templateBytes, QByteArray* pOut)
+{
+    QByteArray inputs(RKG_INPUT_BUFFER_SIZE, '\0');
+    uchar* pInputs = reinterpret_cast<uchar*>(inputs.data());
+    int pos = RKG_INPUT_HEADER_SIZE;
+    int stickOffset = (centering == Centering::Zero) ? NEUTRAL_STICK : 0;
+    int entries[3] = { 0, 0, 0 };
+
+    // One pass per stream, each appending its runs right after the previous stream's
+    for (int stream = 0; stream < 3; stream++)
+    {
+        int maxRun = (stream == 0) ? MAX_BUTTON_RUN : (stream == 1) ? MAX_DIRECTION_RUN : MAX_TRICK_RUN;
+
+        for (int row = 0; row < count; )
+        {
+            const TtkFrame& frame = pFrames[row];
+            int run = 1;
+
+            if (stream == 0)
+            {
+                while (run < maxRun && row + run < count && memcmp(pFrames[row + run].values, frame.values, 3) == 0)
+                    run++;
+            }
+            else if (stream == 1)
+            {
+                while (run < maxRun && row + run < count && memcmp(pFrames[row + run].values + 3, frame.values + 3, 2) == 0)
+                    run++;
+            }
+            else
+            {
+                while (run < maxRun && row + run < count && pFrames[row + run].values[5] == frame.values[5])
+                    run++;
+            }
+
+            if (pos + 2 > RKG_INPUT_BUFFER_SIZE)
+                return false;
+
+            if (stream == 0)
+            {
+                pInputs[pos] = static_cast<uchar>((frame.values[0] ? 0x01 : 0) | (frame.values[1] ? 0x02 : 0) | (frame.values[2] ? 0x04 : 0));
+                pInputs[pos + 1] = static_cast<uchar>(run);
+            }
+            else if (stream == 1)
+            {
+                int lr = frame.values[3] + stickOffset;
+                int ud = frame.values[4] + stickOffset;
+
+                if (lr < 0 || lr > MAX_STICK_VALUE || ud < 0 || ud > MAX_STICK_VALUE)
+                    return false;
+
+                pInputs[pos] = static_cast<uchar>((lr << 4) | ud);
+                pInputs[pos + 1] = static_cast<uchar>(run);
+            }
+            else
+            {
+                writeBe16(pInputs + pos, static_cast<quint16>((frame.values[5] << 12) | run));
+            }
+
+            pos += 2;
+            entries[stream]++;
+            row += run;
+        }
+
+        writeBe16(pInputs + 2 * stream, static_cast<quint16>(entries[stream]));
+    }
+
+    QByteArray compressed;
+    yaz1Compress(pInputs, RKG_INPUT_BUFFER_SIZE, &compressed);
+
+    pOut->resize(RKG_HEADER_SIZE + 4 + compressed.size() + RKG_CRC_SIZE);
+    uchar* pDst = reinterpret_cast<uchar*>(pOut->data());
+
+    if (templateBytes.size() >= RKG_HEADER_SIZE && memcmp(templateBytes.constData(), RKG_MAGIC, 4) == 0)
+    {
+        memcpy(pDst, templateBytes.constData(), RKG_HEADER_SIZE);
+    }
+    else
+    {
+        memset(pDst, 0, RKG_HEADER_SIZE);
+        memcpy(pDst, RKG_MAGIC, 4);
+        writeBe16(pDst + RKG_MII_CRC_OFFSET, crc16(pDst + RKG_MII_OFFSET, RKG_MII_SIZE));
+    }
+
+    pDst[RKG_FLAGS_OFFSET] |= RKG_COMPRESSED_FLAG;
+    writeBe16(pDst + RKG_INPUT_LENGTH_OFFSET, static_cast<quint16>(pos));
+    writeBe32(pDst + RKG_HEADER_SIZE, compressed.size());
+    memcpy(pDst + RKG_HEADER_SIZE + 4, compressed.constData(), compressed.size());
+
+    qint64 crcOffset = pOut->size() - RKG_CRC_SIZE;
+    writeBe32(pDst + crcOffset, crc32(pDst, crcOffset));
+
+    return true;
+}
+
+bool RkgFile::save(const QString& path, const TtkFileData& data, Centering centering)
+{
+    QByteArray templateBytes;
+
+    // Keep the header of the ghost being overwritten
+    QFile existing(path);
+    if (existing.open(QIODevice::ReadOnly))
+    {
+        templateBytes = existing.read(RKG_HEADER_SIZE);
+        existing.close();
+    }
+
+    QByteArray bytes;
+    if (!encode(data.constData(), data.count(), centering, templateBytes, &bytes))
+        return false;
+
+    // Written aside and renamed over the ghost, so a failed write leaves the old one intact
+    QSaveFile fp(path);
+    if (!fp.open(QIODevice::WriteOnly))
+        return false;
+
+    if (fp.write(bytes) != bytes.size())
+    {
+        fp.cancelWriting();
+        return false;
+    }
+
+    return fp.commit();
+}
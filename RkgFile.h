@@ -0,0 +1,32 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QByteArray>
+#include <QString>
+
+#define RKG_EXTENSION ".rkg"
+
+// Mario Kart Wii ghost file. A 0x88-byte header (time, track, combo, Mii, ...) is followed by the
+// input data, usually Yaz1-compressed behind a u32 length, and a CRC32 of everything before it.
+// The input data holds three run-length streams after an 8-byte header of u16 entry counts:
+//
+//   face buttons  u8 buttons (0x01 A, 0x02 B, 0x04 L), u8 frames
+//   direction     u8 (LR << 4) | UD, 0-14 with 7 neutral, u8 frames
+//   trick         u16 (DPad << 12) | frames
+//
+// All fields are big-endian. Ghosts always decode as 7-centered. Encoding reuses the header of
+// an existing ghost when one is given, so rewriting a ghost keeps its Mii, time and so on.
+class RkgFile
+{
+public:
+    static bool isRkgPath(const QString& path);
+
+    static FileStatus load(const QString& path, TtkFileData* pData, quint64* pChecksum = nullptr);
+    static FileStatus fromMemory(const uchar* pBytes, qint64 size, TtkFileData* pData, quint64* pChecksum = nullptr);
+    static bool readChecksum(const QString& path, quint64* pChecksum);
+
+    // Fails if a stick value can't be stored or the runs don't fit in the game's input buffer
+    static bool encode(const TtkFrame* pFrames, int count, Centering centering, const QByteArray& templateBytes, QByteArray* pOut);
+    static bool save(const QString& path, const TtkFileData& data, Centering centering);
+};
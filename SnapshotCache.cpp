@@ -0,0 +1,115 @@
+#include "SnapshotCache.h"
+
+#include "ContentHash.h"
+#include "TtkbFile.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+#define CACHE_MAGIC "TTKC"
+#define CACHE_VERSION 1
+#define CACHE_EXTENSION ".ttkcache"
+#define QUICK_HASH_SPAN 4096
+
+// The cached frames follow the header as a complete .ttkb image
+struct CacheHeader
+{
+    char magic[4];
+    quint32 version;
+    qint64 size;
+    qint64 mtime;
+    quint64 quickHash;
+    quint64 contentHash;
+};
+
+static_assert(sizeof(CacheHeader) == 40, "CacheHeader must stay packed for the cache format");
+
+QString SnapshotCache::pathFor(const QString& filePath)
+{
+    return filePath + CACHE_EXTENSION;
+}
+
+bool SnapshotCache::quickHash(const QString& filePath, qint64 size, quint64* pHash)
+{
+    QFile fp(filePath);
+    if (!fp.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray head = fp.read(QUICK_HASH_SPAN);
+    quint64 hash = contentHash(head.constData(), head.size());
+
+    if (size > QUICK_HASH_SPAN)
+    {
+        fp.seek(qMax<qint64>(QUICK_HASH_SPAN, size - QUICK_HASH_SPAN));
+        QByteArray tail = fp.readAll();
+        hash = contentHash(tail.constData(), tail.size(), hash);
+    }
+
+    *pHash = hash ^ static_cast<quint64>(size);
+    return true;
+}
+
+bool SnapshotCache::load(const QString& filePath, qint64 size, qint64 mtime, TtkFileData* pData, Centering* pCentering, quint64* pContentHash)
+{
+    QFile fp(pathFor(filePath));
+    if (!fp.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 cacheSize = fp.size();
+    if (cacheSize < static_cast<qint64>(sizeof(CacheHeader)))
+        return false;
+
+    uchar* pBytes = fp.map(0, cacheSize);
+    if (pBytes == nullptr)
+        return false;
+
+    const CacheHeader* pHeader = reinterpret_cast<const CacheHeader*>(pBytes);
+    quint64 hash = 0;
+
+    bool bValid = memcmp(pHeader->magic, CACHE_MAGIC, sizeof(pHeader->magic)) == 0
+        && pHeader->version == CACHE_VERSION
+        && pHeader->size == size
+        && pHeader->mtime == mtime
+        && quickHash(filePath, size, &hash)
+        && pHeader->quickHash == hash;
+
+    // The frames carry their own checksum, so a damaged cache is caught here too
+    if (bValid)
+    {
+        Centering centering = Centering::Unknown;
+        bValid = TtkbFile::fromMemory(pBytes + sizeof(CacheHeader), cacheSize - sizeof(CacheHeader), pData, &centering) == FileStatus::Success;
+
+        if (bValid)
+        {
+            *pCentering = centering;
+            *pContentHash = pHeader->contentHash;
+        }
+    }
+
+    fp.unmap(pBytes);
+    return bValid;
+}
+
+bool SnapshotCache::save(const QString& filePath, qint64 size, qint64 mtime, const TtkFileData& data, Centering centering, quint64 contentHash)
+{
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.size = size;
+    header.mtime = mtime;
+    header.contentHash = contentHash;
+
+    if (!quickHash(filePath, size, &header.quickHash))
+        return false;
+
+    QSaveFile fp(pathFor(filePath));
+    if (!fp.open(QIODevice::WriteOnly))
+        return false;
+
+    fp.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+    fp.write(TtkbFile::toBytes(data.constData(), data.count(), centering));
+
+    return fp.commit();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QString>
+
+// Parsed snapshot of a CSV kept in "<file>.ttkcache". The cache is keyed by the CSV's
+// size, modification time and a hash of its first and last few kilobytes; while all
+// three still match, opening the CSV skips parsing and validation entirely.
+class SnapshotCache
+{
+public:
+    static QString pathFor(const QString& filePath);
+
+    static bool load(const QString& filePath, qint64 size, qint64 mtime, TtkFileData* pData, Centering* pCentering, quint64* pContentHash);
+    static bool save(const QString& filePath, qint64 size, qint64 mtime, const TtkFileData& data, Centering centering, quint64 contentHash);
+
+private:
+    static bool quickHash(const QString& filePath, qint64 size, quint64* pHash);
+};
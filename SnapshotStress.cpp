@@ -0,0 +1,119 @@
+// Worker threads read published frame snapshots while the main thread, standing in for the UI
+// thread, keeps editing the file and publishing. Built with -fsanitize=thread, so a write into
+// frames a snapshot still shares is reported as a race; the readers also check that every
+// snapshot they see is whole and that versions never go backwards.
+//
+// Usage: ttk-snapshot-stress [edits]
+
+#include "InputFile.h"
+#include "TtkFrame.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_STRESS_EDITS 20000
+#define STRESS_READERS 4
+#define EDITS_PER_PUBLISH 16
+#define PRESSED_COLUMN 0
+
+static bool writeStressFile(const QString& path, int frameCount)
+{
+    TtkFileData data(frameCount);
+    TtkFrame frame = {{ 0, 0, 0, 7, 7, 0 }};
+    data.fill(frame);
+
+    QByteArray csv;
+    appendCsvLines(data.constData(), data.count(), &csv);
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(csv) == csv.size();
+}
+
+// Every edit presses A on one more frame, so a snapshot at a version has exactly that many pressed
+static int pressedCount(const TtkFileData& frames)
+{
+    int count = 0;
+    for (const TtkFrame& frame : frames)
+        count += frame.values[PRESSED_COLUMN];
+
+    return count;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+
+    int edits = (args.count() > 1) ? args[1].toInt() : DEFAULT_STRESS_EDITS;
+    if (edits <= 0)
+        edits = DEFAULT_STRESS_EDITS;
+
+    QTemporaryDir dir;
+    QString path = dir.filePath("stress.csv");
+
+    if (!dir.isValid() || !writeStressFile(path, edits))
+    {
+        std::cerr << "Could not write the stress file" << std::endl;
+        return 1;
+    }
+
+    InputFile file(InputFileMenus(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr), nullptr, nullptr);
+    if (file.loadFile(path) != FileStatus::Success)
+    {
+        std::cerr << "Could not load the stress file" << std::endl;
+        return 1;
+    }
+
+    const quint64 baseVersion = file.snapshot()->version;
+    std::atomic<bool> bDone(false);
+    std::atomic<int> failures(0);
+    std::atomic<qint64> snapshotsRead(0);
+    std::vector<std::thread> readers;
+
+    for (int i = 0; i < STRESS_READERS; i++)
+    {
+        readers.emplace_back([&]()
+        {
+            quint64 lastVersion = 0;
+
+            while (!bDone.load())
+            {
+                FrameSnapshotPtr snapshot = file.publishedSnapshot();
+
+                bool bWhole = snapshot->frames.count() == edits
+                    && static_cast<quint64>(pressedCount(snapshot->frames)) == snapshot->version - baseVersion;
+
+                if (!bWhole || snapshot->version < lastVersion)
+                    failures++;
+
+                lastVersion = snapshot->version;
+                snapshotsRead++;
+            }
+        });
+    }
+
+    for (int i = 0; i < edits; i++)
+    {
+        file.setCellNumber(i, PRESSED_COLUMN, 1);
+
+        if (i % EDITS_PER_PUBLISH == 0 && file.snapshot()->version != file.getVersion())
+            failures++;
+    }
+
+    file.snapshot();
+    bDone = true;
+
+    for (std::thread& reader : readers)
+        reader.join();
+
+    std::cout << edits << " edits, " << snapshotsRead.load() << " snapshots read by " << STRESS_READERS << " readers, "
+        << failures.load() << " failures" << std::endl;
+
+    return failures.load() == 0 ? 0 : 1;
+}
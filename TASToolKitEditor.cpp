@@ -1,33 +1,58 @@
 #include "TASToolKitEditor.h"
 
+#include "EditBus.h"
+#include "EditMacro.h"
+#include "FrameClipboard.h"
+#include "FileWatchService.h"
+#include "FrameAlign.h"
+#include "FrameMinimap.h"
+#include "FrameResidency.h"
+#include "FrameSelection.h"
+#include "FrameCursor.h"
+#include "HistoryScrubber.h"
 #include "InputFile.h"
 #include "InputFileModel.h"
+#include "InputPlot.h"
+#include "RkgFile.h"
+#include "Trace.h"
+#include "TransformScript.h"
+#include "TtkbFile.h"
 
 //#include <QAbstractSlider>
+#include <QCloseEvent>
+#include <QElapsedTimer>
 #include <QFileDialog>
-#include <QFileSystemWatcher>
+#include <QInputDialog>
+#include <QItemSelectionModel>
 #include <QMessageBox>
 #include <QPushButton>
 #include <QScrollBar>
 #include <QTextStream>
+#include <QTimer>
 
 #include <iostream>
 
 #define FRAMECOUNT_COLUMN_WIDTH 40
-#define BUTTON_COLUMN_WIDTH 20
-#define STICK_COLUMN_WIDTH 25
-#define PAD_COLUMN_WIDTH 35
 
-#define COLUMN_WIDTH_SUM (FRAMECOUNT_COLUMN_WIDTH + (3 * BUTTON_COLUMN_WIDTH) + (2 * STICK_COLUMN_WIDTH) + PAD_COLUMN_WIDTH + 25)
+#define TABLE_MINIMAP_SPACING 4
+#define COLUMN_WIDTH_SUM (FRAMECOUNT_COLUMN_WIDTH + columnWidthSum() + 25 + TABLE_MINIMAP_SPACING + MINIMAP_WIDTH)
 
 #define TABLE_SIDE_PADDING 10
 #define SINGLE_FILE_WINDOW_WIDTH ((COLUMN_WIDTH_SUM) + (2 * TABLE_SIDE_PADDING))
 #define DOUBLE_FILE_WINDOW_WIDTH (SINGLE_FILE_WINDOW_WIDTH * 2)
 #define DEFAULT_WINDOW_HEIGHT 500
 #define DEFAULT_TABLE_COL_WIDTH 30
+#define TRACE_OVERLAY_INTERVAL_MS 500
+#define STATUS_MESSAGE_MS 5000
+#define ALIGN_DEFAULT_SEGMENT 600
+#define ALIGN_MIN_SEGMENT 120
+#define ALIGN_POLL_MS 20
 
 TASToolKitEditor::TASToolKitEditor(QWidget *parent)
     : QMainWindow(parent)
+    , m_alignPlayerVersion(0)
+    , m_alignGhostVersion(0)
+    , m_pMacroSource(nullptr)
 {
     setupUi();
     createInputFileInstances();
@@ -40,6 +65,8 @@ void TASToolKitEditor::createInputFileInstances()
     InputFileMenus ghostMenus = InputFileMenus(menuGhost, actionUndoGhost, actionRedoGhost, actionCloseGhost, action0CenteredGhost, action7CenteredGhost);
     playerFile = new InputFile(playerMenus, playerLabel, playerTableView);
     ghostFile = new InputFile(ghostMenus, ghostLabel, ghostTableView);
+    playerBus = new EditBus(playerFile, this);
+    ghostBus = new EditBus(ghostFile, this);
 }
 
 void TASToolKitEditor::connectActions()
@@ -52,22 +79,112 @@ void TASToolKitEditor::connectActions()
     connect(actionUndoGhost, &QAction::triggered, this, [this]() { onUndoRedo(ghostFile, EOperationType::Undo); });
     connect(actionRedoPlayer, &QAction::triggered, this, [this]() { onUndoRedo(playerFile, EOperationType::Redo); });
     connect(actionRedoGhost, &QAction::triggered, this, [this]() { onUndoRedo(ghostFile, EOperationType::Redo); });
+    connect(actionHistoryPlayer, &QAction::toggled, this, [this](bool bShow) { onToggleHistoryTimeline(playerFile, bShow); });
+    connect(actionHistoryGhost, &QAction::toggled, this, [this](bool bShow) { onToggleHistoryTimeline(ghostFile, bShow); });
+    connect(playerHistoryScrubber, &HistoryScrubber::stepRequested, this, [this](int step) { onHistoryStep(playerFile, step); });
+    connect(ghostHistoryScrubber, &HistoryScrubber::stepRequested, this, [this](int step) { onHistoryStep(ghostFile, step); });
+    connect(playerHistoryScrubber, &HistoryScrubber::restoreRequested, this, [this]() { restoreHistoryStep(playerFile); });
+    connect(ghostHistoryScrubber, &HistoryScrubber::restoreRequested, this, [this]() { restoreHistoryStep(ghostFile); });
+    connect(actionCopyPlayer, &QAction::triggered, this, [this]() { copyFrames(playerFile); });
+    connect(actionCopyGhost, &QAction::triggered, this, [this]() { copyFrames(ghostFile); });
+    connect(actionCutPlayer, &QAction::triggered, this, [this]() { cutFrames(playerFile); });
+    connect(actionCutGhost, &QAction::triggered, this, [this]() { cutFrames(ghostFile); });
+    connect(actionPastePlayer, &QAction::triggered, this, [this]() { pasteFrames(playerFile); });
+    connect(actionPasteGhost, &QAction::triggered, this, [this]() { pasteFrames(ghostFile); });
     connect(actionScrollTogether, &QAction::toggled, this, &TASToolKitEditor::onToggleScrollTogether);
+    connect(actionConvertFile, &QAction::triggered, this, &TASToolKitEditor::convertFile);
+    connect(actionFollowEmulator, &QAction::toggled, this, &TASToolKitEditor::onToggleFollowEmulator);
+    connect(actionShowPlots, &QAction::toggled, this, &TASToolKitEditor::onToggleShowPlots);
+    connect(actionFollowAppends, &QAction::toggled, this, &TASToolKitEditor::onToggleFollowAppends);
+    connect(actionAlignFiles, &QAction::triggered, this, [this]() { alignFiles(0); });
+    connect(actionAlignSegments, &QAction::triggered, this, &TASToolKitEditor::alignFilesBySegment);
+    connect(actionClearAlignment, &QAction::triggered, this, &TASToolKitEditor::clearAlignment);
+    connectEditBus(playerFile);
+    connectEditBus(ghostFile);
+    connect(frameCursorReader, &FrameCursorReader::cursorMoved, this, &TASToolKitEditor::onFrameCursor);
+    connect(fileWatchService, &FileWatchService::reloadDue, this, &TASToolKitEditor::onReloadDue);
+    connect(playerTableView, &QTableView::clicked, this, [this](const QModelIndex& index) { playerFile->onCellClicked(index); });
+    connect(ghostTableView, &QTableView::clicked, this, [this](const QModelIndex& index) { ghostFile->onCellClicked(index); });
+    connect(actionExportPlayer, &QAction::triggered, this, [this]() { exportFile(playerFile); });
+    connect(actionExportGhost, &QAction::triggered, this, [this]() { exportFile(ghostFile); });
+    connect(actionTransformPlayer, &QAction::triggered, this, [this]() { runTransform(playerFile); });
+    connect(actionTransformGhost, &QAction::triggered, this, [this]() { runTransform(ghostFile); });
+    connect(actionPlayMacroPlayer, &QAction::triggered, this, [this]() { playMacro(playerFile); });
+    connect(actionPlayMacroGhost, &QAction::triggered, this, [this]() { playMacro(ghostFile); });
+    connect(actionRecordMacro, &QAction::toggled, this, &TASToolKitEditor::onToggleRecordMacro);
+    connect(actionDeleteMacro, &QAction::triggered, this, &TASToolKitEditor::deleteMacro);
     connect(playerTableView->verticalScrollBar(), &QAbstractSlider::valueChanged, this, [this]() { onScroll(playerFile); });
     connect(ghostTableView->verticalScrollBar(), &QAbstractSlider::valueChanged, this, [this]() { onScroll(ghostFile); });
+    connect(playerTableView->verticalScrollBar(), &QAbstractSlider::valueChanged, playerMinimap, [this]() { playerMinimap->update(); });
+    connect(ghostTableView->verticalScrollBar(), &QAbstractSlider::valueChanged, ghostMinimap, [this]() { ghostMinimap->update(); });
+    connect(playerTableView->verticalScrollBar(), &QAbstractSlider::valueChanged, this, [this]() { updatePlotRange(playerFile); });
+    connect(ghostTableView->verticalScrollBar(), &QAbstractSlider::valueChanged, this, [this]() { updatePlotRange(ghostFile); });
+    connect(playerMinimap, &FrameMinimap::frameRequested, this, [this](int rowIdx) { jumpToRow(playerFile, rowIdx); });
+    connect(ghostMinimap, &FrameMinimap::frameRequested, this, [this](int rowIdx) { jumpToRow(ghostFile, rowIdx); });
     
     connect(action0CenteredPlayer, &QAction::triggered, this, [this]() { onReCenter(playerFile, Centering::Zero); });
     connect(action0CenteredGhost, &QAction::triggered, this, [this]() { onReCenter(ghostFile, Centering::Zero); });
     connect(action7CenteredPlayer, &QAction::triggered, this, [this]() { onReCenter(playerFile, Centering::Seven); });
     connect(action7CenteredGhost, &QAction::triggered, this, [this]() { onReCenter(ghostFile, Centering::Seven); });
+
+#ifdef TTK_TRACING
+    connect(actionExportTrace, &QAction::triggered, this, &TASToolKitEditor::exportTrace);
+    connect(traceOverlayTimer, &QTimer::timeout, this, &TASToolKitEditor::updateTraceOverlay);
+#endif
+}
+
+#ifdef TTK_TRACING
+void TASToolKitEditor::exportTrace()
+{
+    QString filePath = QFileDialog::getSaveFileName(this, "Export Trace", "", "Chrome Trace (*.json)");
+
+    if (filePath == "")
+        return;
+
+    if (!TraceBuffer::instance().exportChromeTrace(filePath))
+        showError("Error Exporting Trace", "The trace could not be written to the selected file.");
 }
 
+void TASToolKitEditor::updateTraceOverlay()
+{
+    const TraceBuffer& trace = TraceBuffer::instance();
+    QString text = QString("Edit to disk p50 %1 ms  p99 %2 ms")
+        .arg(trace.latencyPercentileNs(50) / 1000000.0, 0, 'f', 2)
+        .arg(trace.latencyPercentileNs(99) / 1000000.0, 0, 'f', 2);
+
+    if (playerFile->getPath() != "")
+        text += QString("  |  Player %1 KB").arg(playerFile->memoryUsage() / 1024);
+    if (ghostFile->getPath() != "")
+        text += QString("  |  Ghost %1 KB").arg(ghostFile->memoryUsage() / 1024);
+
+    const ReloadStats& reloads = fileWatchService->getStats();
+    if (reloads.reloads > 0)
+        text += QString("  |  Reloads %1 (%2 events) last %3 ms max %4 ms")
+            .arg(reloads.reloads).arg(reloads.changeEvents).arg(reloads.lastLatencyMs).arg(reloads.maxLatencyMs);
+
+    const ResidencyStats& residency = FrameResidency::instance().getStats();
+    if (residency.entries > 0)
+        text += QString("  |  Kept frames %1 KB (+%2 KB packed) hits %3 misses %4")
+            .arg(residency.expandedBytes / 1024).arg(residency.compressedBytes / 1024).arg(residency.hits).arg(residency.misses);
+
+    traceOverlayLabel->setText(text);
+}
+#endif
+
 void TASToolKitEditor::onReCenter(InputFile* pInputFile, Centering centering)
 {
+    if (recenterFile(pInputFile, centering))
+        busFor(pInputFile)->publishRecenter(centering);
+}
+
+bool TASToolKitEditor::recenterFile(InputFile* pInputFile, Centering centering)
+{
+    TTK_TRACE_SCOPE("recenter");
+
     if (pInputFile->getCentering() == centering)
-        return;
+        return false;
     else if (pInputFile->getCentering() == Centering::Unknown)
-        return;
+        return false;
     else
         pInputFile->setCentering(centering);
 
@@ -77,16 +194,8 @@ void TASToolKitEditor::onReCenter(InputFile* pInputFile, Centering centering)
 
     int stickOffset = (centering == Centering::Seven) ? 7 : -7;
 
-    // Iterate across data to readjust all stick values
-    const TtkFileData& data = pInputFile->getData();
-    for (int i = 0; i < data.count(); i++)
-    {
-        for (int j = 3; j < 5; j++)
-        {
-            QString strVal = pInputFile->getCellValue(i, j);
-            pInputFile->setCellValue(i, j, QString::number(strVal.toInt() + stickOffset));
-        }
-    }
+    // Readjust all stick values
+    pInputFile->offsetSticks(stickOffset);
 
     // So rather than have thousands of undo operations appear because of this operation,
     // just clear the stacks...
@@ -95,11 +204,49 @@ void TASToolKitEditor::onReCenter(InputFile* pInputFile, Centering centering)
 
     // Finally, save to the file
     InputFileModel::writeFileOnDisk(pInputFile);
+    return true;
+}
+
+EditBus* TASToolKitEditor::busFor(InputFile* pInputFile)
+{
+    return (pInputFile == playerFile) ? playerBus : ghostBus;
+}
+
+void TASToolKitEditor::connectEditBus(InputFile* pInputFile)
+{
+    EditBus* pBus = busFor(pInputFile);
+
+    // Only the instance hosting the bus writes the file
+    connect(pBus, &EditBus::remoteChangesApplied, this, [pInputFile]() { InputFileModel::writeFileOnDisk(pInputFile); });
+    connect(pBus, &EditBus::recenterReceived, this, [this, pInputFile](Centering centering)
+    {
+        if (recenterFile(pInputFile, centering))
+            emit pInputFile->getTableView()->model()->layoutChanged();
+    });
+    connect(pBus, &EditBus::resyncNeeded, this, [this, pInputFile]() { resyncFromDisk(pInputFile); });
+}
+
+void TASToolKitEditor::resyncFromDisk(InputFile* pInputFile)
+{
+    QString filePath = pInputFile->getPath();
+    if (filePath == "")
+        return;
+
+    pInputFile->loadFile(filePath);
+
+    if (pInputFile->getPath() == "")
+    {
+        fileWatchService->unwatch(filePath);
+        busFor(pInputFile)->detach();
+    }
+
+    adjustInputCenteringMenu(pInputFile);
+    emit pInputFile->getTableView()->model()->layoutChanged();
 }
 
 void TASToolKitEditor::onScroll(InputFile* pInputFile)
 {
-    if (!m_bScrollTogether)
+    if (!m_bScrollTogether || m_bSyncingScroll)
         return;
 
     // What row is the current table at?
@@ -113,8 +260,69 @@ void TASToolKitEditor::onScroll(InputFile* pInputFile)
     else
         otherFile = playerFile;
 
-    // Scroll other table to that row
+    // Scroll other table to that row. Rows clamped at either end of an aligned file don't map
+    // back to the same row, so the other table's scroll mustn't bounce back to this one.
+    m_bSyncingScroll = true;
     scrollToFirstTable(pInputFile->getTableView(), otherFile->getTableView());
+    m_bSyncingScroll = false;
+}
+
+void TASToolKitEditor::jumpToRow(InputFile* pInputFile, int rowIdx)
+{
+    QTableView* pTable = pInputFile->getTableView();
+    pTable->scrollTo(pTable->model()->index(rowIdx, 0), QAbstractItemView::PositionAtCenter);
+}
+
+FrameMinimap* TASToolKitEditor::minimapFor(InputFile* pInputFile)
+{
+    return (pInputFile == playerFile) ? playerMinimap : ghostMinimap;
+}
+
+InputPlot* TASToolKitEditor::plotFor(InputFile* pInputFile)
+{
+    return (pInputFile == playerFile) ? playerPlot : ghostPlot;
+}
+
+int TASToolKitEditor::windowHeight()
+{
+    return DEFAULT_WINDOW_HEIGHT + (actionShowPlots->isChecked() ? PLOT_PANEL_HEIGHT : 0);
+}
+
+void TASToolKitEditor::onToggleShowPlots(bool bShow)
+{
+    for (InputFile* pInputFile : { playerFile, ghostFile })
+    {
+        plotFor(pInputFile)->setVisible(bShow && pInputFile->getPath() != "");
+        updatePlotRange(pInputFile);
+    }
+
+    resize(width(), windowHeight());
+}
+
+void TASToolKitEditor::updatePlotRange(InputFile* pInputFile)
+{
+    InputPlot* pPlot = plotFor(pInputFile);
+    if (pPlot->isHidden())
+        return;
+
+    // The selection if there is one, otherwise whatever is scrolled into view
+    QTableView* pTable = pInputFile->getTableView();
+    int firstRow, lastRow;
+
+    if (pTable->selectionModel() != nullptr && !selectedFrames(pInputFile).isEmpty())
+    {
+        selectedRowSpan(pInputFile, &firstRow, &lastRow);
+    }
+    else
+    {
+        firstRow = qMax(0, pTable->rowAt(0));
+        lastRow = pTable->rowAt(pTable->viewport()->height() - 1);
+
+        if (lastRow < 0)
+            lastRow = pInputFile->getData().count() - 1;
+    }
+
+    pPlot->setRange(firstRow, lastRow);
 }
 
 void TASToolKitEditor::onToggleScrollTogether(bool bTogether)
@@ -127,56 +335,606 @@ void TASToolKitEditor::onToggleScrollTogether(bool bTogether)
         return;
 
     // Jump ghost view to same row as player view
+    m_bSyncingScroll = true;
     scrollToFirstTable(playerTableView, ghostTableView);
+    m_bSyncingScroll = false;
+}
+
+void TASToolKitEditor::alignFiles(int segmentLength)
+{
+    if (m_alignTask.valid())
+        return;
+
+    // Correlate snapshots on a worker so both files stay editable meanwhile
+    FrameSnapshotPtr player = playerFile->snapshot();
+    FrameSnapshotPtr ghost = ghostFile->snapshot();
+
+    // What was aligned, so a result for frames that have since changed can be dropped
+    m_alignPlayerPath = playerFile->getPath();
+    m_alignGhostPath = ghostFile->getPath();
+    m_alignPlayerVersion = player->version;
+    m_alignGhostVersion = ghost->version;
+
+    m_alignTask = std::async(std::launch::async, [player, ghost, segmentLength]()
+    {
+        FrameAlign alignment;
+        alignment.align(player->frames, player->centering, ghost->frames, ghost->centering, segmentLength);
+        return alignment;
+    });
+
+    m_alignClock.start();
+    alignPollTimer->start();
+    statusBar()->showMessage("Aligning...");
+}
+
+void TASToolKitEditor::onAlignPoll()
+{
+    if (m_alignTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    alignPollTimer->stop();
+    FrameAlign alignment = m_alignTask.get();
+    statusBar()->clearMessage();
+
+    // A file was closed while aligning
+    if (m_filesLoaded < 2)
+        return;
+
+    // A file was replaced, reloaded or edited while aligning
+    if (playerFile->getPath() != m_alignPlayerPath || ghostFile->getPath() != m_alignGhostPath
+        || playerFile->getVersion() != m_alignPlayerVersion || ghostFile->getVersion() != m_alignGhostVersion)
+    {
+        statusBar()->showMessage("The files changed while aligning; align them again.", STATUS_MESSAGE_MS);
+        return;
+    }
+
+    if (!alignment.isValid())
+    {
+        showError("Error aligning files", "The files are too short or too uneventful to line up.");
+        return;
+    }
+
+    m_alignment = alignment;
+    actionClearAlignment->setEnabled(true);
+    statusBar()->showMessage(QString("Ghost frame = player frame %1%2 (match %3) in %4 ms")
+        .arg(m_alignment.getOffset() < 0 ? "- " : "+ ").arg(qAbs(m_alignment.getOffset()))
+        .arg(m_alignment.getScore(), 0, 'f', 2).arg(m_alignClock.elapsed()), STATUS_MESSAGE_MS);
+
+    if (m_alignment.getSegments().count() > 1)
+    {
+        const QVector<AlignSegment>& segments = m_alignment.getSegments();
+        QString report;
+
+        for (int i = 0; i < segments.count(); i++)
+        {
+            int lastRow = (i + 1 < segments.count()) ? segments[i + 1].firstRow - 1 : playerFile->getData().count() - 1;
+            report += QString("Player frames %1-%2: ghost %3%4 (match %5)\n").arg(segments[i].firstRow + 1).arg(lastRow + 1)
+                .arg(segments[i].offset < 0 ? "- " : "+ ").arg(qAbs(segments[i].offset)).arg(segments[i].score, 0, 'f', 2);
+        }
+
+        QMessageBox::information(this, "Alignment", report);
+    }
+
+    onToggleScrollTogether(true);
+}
+
+void TASToolKitEditor::alignFilesBySegment()
+{
+    bool bOk;
+    int segmentLength = QInputDialog::getInt(this, "Align Files by Segment", "Frames per segment:",
+        ALIGN_DEFAULT_SEGMENT, ALIGN_MIN_SEGMENT, qMax(ALIGN_MIN_SEGMENT, playerFile->getData().count()), 60, &bOk);
+
+    if (bOk)
+        alignFiles(segmentLength);
+}
+
+void TASToolKitEditor::clearAlignment()
+{
+    m_alignment.clear();
+    actionClearAlignment->setEnabled(false);
+
+    if (m_bScrollTogether)
+        onToggleScrollTogether(true);
+}
+
+void TASToolKitEditor::onToggleFollowAppends(bool bFollow)
+{
+    playerFile->setFollowTail(bFollow);
+    ghostFile->setFollowTail(bFollow);
+    actionAutoScrollAppends->setEnabled(bFollow);
+}
+
+void TASToolKitEditor::onToggleFollowEmulator(bool bFollow)
+{
+    if (bFollow)
+    {
+        frameCursorReader->start();
+        return;
+    }
+
+    frameCursorReader->stop();
+    onFrameCursor(NO_CURSOR_FRAME, NO_CURSOR_FRAME);
+}
+
+void TASToolKitEditor::onFrameCursor(int playerFrame, int ghostFrame)
+{
+    TTK_TRACE_SCOPE("frameCursor");
+
+    moveCursorRow(playerFile, playerFrame);
+    moveCursorRow(ghostFile, ghostFrame);
+}
+
+void TASToolKitEditor::moveCursorRow(InputFile* pInputFile, int frame)
+{
+    if (pInputFile->getPath() == "")
+        return;
+
+    QTableView* pTable = pInputFile->getTableView();
+    InputFileModel* pModel = (InputFileModel*) pTable->model();
+    pModel->setCursorRow(frame);
+
+    if (pModel->getCursorRow() < 0)
+        return;
+
+    // Only scroll once the cursor leaves the visible rows
+    int rowUpper = pTable->rowAt(0);
+    int rowLower = pTable->rowAt(pTable->viewport()->height() - 1);
+
+    if (frame < rowUpper || (rowLower >= 0 && frame > rowLower))
+        pTable->scrollTo(pModel->index(frame, 0), QAbstractItemView::PositionAtCenter);
 }
 
 void TASToolKitEditor::scrollToFirstTable(QTableView* dst, QTableView* src)
 {
     int dstTopRow = dst->rowAt(0);
-    QModelIndex index = src->model()->index(dstTopRow, 0);
+    int srcRow = dstTopRow;
+
+    // Aligned files scroll to the matching frame instead of the same row
+    if (m_alignment.isValid())
+        srcRow = (dst == playerTableView) ? m_alignment.ghostRowFor(dstTopRow) : m_alignment.playerRowFor(dstTopRow);
+
+    srcRow = qBound(0, srcRow, src->model()->rowCount() - 1);
+    QModelIndex index = src->model()->index(srcRow, 0);
     src->setCurrentIndex(index);
     src->scrollTo(index, QAbstractItemView::PositionAtTop);
 }
 
+void TASToolKitEditor::selectedRowSpan(InputFile* pInputFile, int* pFirstRow, int* pLastRow)
+{
+    // The rows spanned by the selection, or the whole file when nothing is selected
+    FrameRanges frames = selectedFrames(pInputFile);
+
+    *pFirstRow = frames.isEmpty() ? 0 : frames.firstFrame();
+    *pLastRow = frames.isEmpty() ? pInputFile->getData().count() - 1 : frames.lastFrame();
+}
+
+FrameRanges TASToolKitEditor::selectedFrames(InputFile* pInputFile)
+{
+    // Rows past the end can stay selected for a moment while a reload shrinks the file
+    FrameSelectionModel* pSelection = qobject_cast<FrameSelectionModel*>(pInputFile->getTableView()->selectionModel());
+    if (pSelection == nullptr)
+        return FrameRanges();
+
+    return pSelection->frames().clampedTo(pInputFile->getData().count());
+}
+
+void TASToolKitEditor::copyFrames(InputFile* pInputFile)
+{
+    FrameRanges frames = selectedFrames(pInputFile);
+    if (frames.isEmpty())
+        return;
+
+    // Copies what the table shows, which is the previewed state while the history timeline is open
+    InputFileModel* pModel = (InputFileModel*) pInputFile->getTableView()->model();
+    const TtkFileData& data = pModel->isPreviewingHistory() ? pModel->getTimeline().preview() : pInputFile->getData();
+
+    FrameClipboard::copy(data, frames, pInputFile->getCentering());
+    statusBar()->showMessage(QString("Copied %1 frames").arg(frames.frameCount()), STATUS_MESSAGE_MS);
+}
+
+void TASToolKitEditor::cutFrames(InputFile* pInputFile)
+{
+    closeHistoryTimeline(pInputFile);
+
+    FrameRanges frames = selectedFrames(pInputFile);
+    if (frames.isEmpty())
+        return;
+
+    FrameClipboard::copy(pInputFile->getData(), frames, pInputFile->getCentering());
+
+    // The file keeps its length, so cut frames go back to no input. One span of frames is
+    // applied so the whole cut is a single undo step.
+    int firstRow = frames.firstFrame();
+    int count = frames.lastFrame() - firstRow + 1;
+    TtkFileData span(count);
+    memcpy(span.data(), pInputFile->getData().constData() + firstRow, count * sizeof(TtkFrame));
+
+    TtkFrame neutral;
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        neutral.values[col] = (isStickColumn(col) && pInputFile->getCentering() == Centering::Seven) ? 7 : 0;
+
+    for (const FrameRange& range : frames.ranges())
+    {
+        for (int row = range.first; row <= range.last; row++)
+            span[row - firstRow] = neutral;
+    }
+
+    int changed = ((InputFileModel*) pInputFile->getTableView()->model())->applyFrames(firstRow, span.constData(), count);
+    statusBar()->showMessage(QString("Cut %1 frames (%2 cells changed)").arg(frames.frameCount()).arg(changed), STATUS_MESSAGE_MS);
+}
+
+void TASToolKitEditor::pasteFrames(InputFile* pInputFile)
+{
+    closeHistoryTimeline(pInputFile);
+
+    QTableView* pTable = pInputFile->getTableView();
+    FrameRanges frames = selectedFrames(pInputFile);
+    int firstRow = frames.isEmpty() ? pTable->currentIndex().row() : frames.firstFrame();
+    int frameCount = pInputFile->getData().count();
+
+    if (firstRow < 0 || firstRow >= frameCount)
+        return;
+
+    TtkFileData pasted;
+    int errorLine = 0;
+    FileStatus status = FrameClipboard::paste(pInputFile->getCentering(), &pasted, &errorLine);
+
+    if (status != FileStatus::Success || pasted.isEmpty())
+    {
+        QString detail = (errorLine > 0) ? QString("Frame %1 on the clipboard isn't valid for this file.").arg(errorLine)
+            : QString("The clipboard doesn't hold any frames.");
+        showError("Paste Frames", detail + "\n\nNo changes were made.");
+        return;
+    }
+
+    // Pasting overwrites from the first selected frame and stops at the end of the file
+    int count = qMin(pasted.count(), frameCount - firstRow);
+    int changed = ((InputFileModel*) pTable->model())->applyFrames(firstRow, pasted.constData(), count);
+
+    QAbstractItemModel* pModel = pTable->model();
+    pTable->selectionModel()->select(QItemSelection(pModel->index(firstRow, 0), pModel->index(firstRow + count - 1, pModel->columnCount() - 1)),
+        QItemSelectionModel::ClearAndSelect);
+
+    QString message = QString("Pasted %1 frames (%2 cells changed)").arg(count).arg(changed);
+    if (count < pasted.count())
+        message += QString(", %1 past the end of the file were dropped").arg(pasted.count() - count);
+
+    statusBar()->showMessage(message, STATUS_MESSAGE_MS);
+}
+
+void TASToolKitEditor::onToggleRecordMacro(bool bRecord)
+{
+    if (bRecord)
+    {
+        m_recordingMacro.clear();
+        m_pMacroSource = nullptr;
+        statusBar()->showMessage("Recording macro...");
+        return;
+    }
+
+    statusBar()->clearMessage();
+
+    if (m_recordingMacro.isEmpty())
+        return;
+
+    m_recordingMacro.finishRecording(m_pMacroSource->getCentering());
+
+    bool bOk = false;
+    QString name = QInputDialog::getText(this, "Save Macro", "Macro name:", QLineEdit::Normal, "", &bOk);
+
+    // Slashes would nest the macro inside a settings group
+    name = name.trimmed().replace('/', '-').replace('\\', '-');
+
+    if (bOk && name != "")
+        m_recordingMacro.save(name);
+
+    m_recordingMacro.clear();
+}
+
+void TASToolKitEditor::recordMacroEdit(InputFile* pInputFile, int rowIdx, int colIdx, int value)
+{
+    if (!actionRecordMacro->isChecked())
+        return;
+
+    // A macro is recorded from one file, whichever is edited first
+    if (m_pMacroSource == nullptr)
+        m_pMacroSource = pInputFile;
+    else if (m_pMacroSource != pInputFile)
+        return;
+
+    m_recordingMacro.recordEdit(rowIdx, colIdx, value);
+}
+
+void TASToolKitEditor::playMacro(InputFile* pInputFile)
+{
+    closeHistoryTimeline(pInputFile);
+
+    QStringList names = EditMacro::savedNames();
+    if (names.isEmpty())
+    {
+        showError("Play Macro", "No macros have been recorded yet.");
+        return;
+    }
+
+    bool bOk = false;
+    QString name = QInputDialog::getItem(this, "Play Macro", "Macro:", names, 0, false, &bOk);
+    if (!bOk)
+        return;
+
+    EditMacro macro;
+    if (!EditMacro::load(name, &macro) || macro.isEmpty())
+    {
+        showError("Play Macro", "This macro is damaged and can't be played.");
+        return;
+    }
+
+    // It plays at the first selected frame, and repeats across the selection if it is longer than the macro
+    int firstRow, lastRow;
+    selectedRowSpan(pInputFile, &firstRow, &lastRow);
+
+    if (selectedFrames(pInputFile).isEmpty())
+        lastRow = firstRow;
+
+    lastRow = qMax(lastRow, firstRow + macro.span() - 1);
+
+    if (lastRow >= pInputFile->getData().count())
+    {
+        showError("Play Macro", "The macro runs past the end of the file from the selected frame.");
+        return;
+    }
+
+    int interval = 0;
+    if (lastRow - firstRow + 1 > macro.span())
+    {
+        interval = QInputDialog::getInt(this, "Play Macro", QString("Repeat every how many frames between frames %1 and %2?").arg(firstRow + 1).arg(lastRow + 1),
+            macro.span(), 1, lastRow - firstRow + 1, 1, &bOk);
+
+        if (!bOk)
+            return;
+    }
+
+    int count = lastRow - firstRow + 1;
+    TtkFileData frames(count);
+    memcpy(frames.data(), pInputFile->getData().constData() + firstRow, count * sizeof(TtkFrame));
+
+    QString error;
+    if (!macro.apply(frames.data(), firstRow, count, firstRow, interval, pInputFile->getCentering(), &error))
+    {
+        showError("Play Macro", error + "\n\nNo changes were made.");
+        return;
+    }
+
+    int changed = ((InputFileModel*) pInputFile->getTableView()->model())->applyFrames(firstRow, frames.constData(), count);
+    statusBar()->showMessage(QString("Macro \"%1\" changed %2 cells").arg(name).arg(changed), STATUS_MESSAGE_MS);
+}
+
+void TASToolKitEditor::runTransform(InputFile* pInputFile)
+{
+    closeHistoryTimeline(pInputFile);
+
+    int firstRow, lastRow;
+    selectedRowSpan(pInputFile, &firstRow, &lastRow);
+
+    QString label = QString("Frames %1-%2. One \"column = expression\" per line, e.g. LR = 2 * center - LR\n"
+        "Columns: A B L LR UD DPad. Also f (frame), i (index in span), n (span length), center.")
+        .arg(firstRow + 1).arg(lastRow + 1);
+
+    bool bOk = false;
+    QString source = QInputDialog::getMultiLineText(this, "Run Transform", label, m_lastTransformScript, &bOk);
+
+    if (!bOk || source.trimmed() == "")
+        return;
+
+    m_lastTransformScript = source;
+
+    TransformScript script;
+    QString error;
+
+    if (!script.compile(source, &error))
+    {
+        showError("Error in Transform", error);
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int count = lastRow - firstRow + 1;
+    TtkFileData frames(count);
+
+    if (!script.run(pInputFile->getData().constData() + firstRow, frames.data(), firstRow, count, pInputFile->getCentering(), &error))
+    {
+        showError("Error in Transform", error + "\n\nNo changes were made.");
+        return;
+    }
+
+    int changed = ((InputFileModel*) pInputFile->getTableView()->model())->applyFrames(firstRow, frames.constData(), count);
+
+    statusBar()->showMessage(QString("Transform changed %1 cells in %2 ms").arg(changed).arg(timer.elapsed()), STATUS_MESSAGE_MS);
+}
+
+void TASToolKitEditor::updateStatsPanel(InputFile* pInputFile)
+{
+    QLabel* pStatsLabel = (pInputFile == playerFile) ? playerStatsLabel : ghostStatsLabel;
+    int frameCount = pInputFile->getData().count();
+
+    if (pInputFile->getPath() == "" || frameCount == 0)
+    {
+        pStatsLabel->setVisible(false);
+        return;
+    }
+
+    int firstRow, lastRow;
+    selectedRowSpan(pInputFile, &firstRow, &lastRow);
+
+    QString text = QString("Frames %1-%2 (%3)\n").arg(firstRow + 1).arg(lastRow + 1).arg(lastRow - firstRow + 1);
+    QString histograms;
+
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+    {
+        ColumnStats stats = pInputFile->getColumnStats(firstRow, lastRow, col);
+
+        if (isButtonColumn(col))
+        {
+            text += QString("%1 %2 held, %3 presses").arg(TTK_COLUMNS[col].name).arg(stats.countOf(1)).arg(stats.presses);
+            text += (col + 1 < NUM_INPUT_COLUMNS && isButtonColumn(col + 1)) ? "   " : "\n";
+            continue;
+        }
+
+        if (isStickColumn(col))
+            text += QString("%1 avg %2 (%3..%4)   ").arg(TTK_COLUMNS[col].name).arg(static_cast<double>(stats.sum) / stats.frames, 0, 'f', 2).arg(stats.minValue).arg(stats.maxValue);
+        else
+            text += QString("\n%1 %2 presses").arg(TTK_COLUMNS[col].name).arg(stats.presses);
+
+        histograms += QString("%1:").arg(TTK_COLUMNS[col].name);
+        for (int value = stats.minValue; value <= stats.maxValue; value++)
+        {
+            if (stats.countOf(value) > 0)
+                histograms += QString(" %1x%2").arg(value).arg(stats.countOf(value));
+        }
+        histograms += (col == NUM_INPUT_COLUMNS - 1) ? "" : "\n";
+    }
+
+    pStatsLabel->setText(text);
+    pStatsLabel->setToolTip(histograms);
+    pStatsLabel->setVisible(true);
+}
+
 void TASToolKitEditor::onUndoRedo(InputFile* pInputFile, EOperationType opType)
 {
     bool bUndo = opType == EOperationType::Undo;
+    TTK_TRACE_SCOPE(bUndo ? "undo" : "redo");
 
     TtkStack* undoStack = pInputFile->getUndoStack();
     TtkStack* redoStack = pInputFile->getRedoStack();
 
+    // Undo and redo act on the file itself, so a history preview would be out of date
+    closeHistoryTimeline(pInputFile);
+
     // Refuse operation if the associated stack is empty
     if (bUndo && undoStack->count() == 0)
         return;
     if (!bUndo && redoStack->count() == 0)
         return;
 
-    CellEditAction action = bUndo ? undoStack->pop() : redoStack->pop();
-    action.flipValues();
+    TtkStack* srcStack = bUndo ? undoStack : redoStack;
+    TtkStack* dstStack = bUndo ? redoStack : undoStack;
 
-    if (bUndo)
-        redoStack->push(action);
-    else
-        undoStack->push(action);
+    // Move a whole transaction at once
+    QVector<CellEditAction> group;
+    srcStack->moveTopGroup(dstStack, &group);
 
-    pInputFile->setCellValue(action.row(), action.col(), action.curVal());
+    pInputFile->applyEdits(group);
+    busFor(pInputFile)->publishCells(group);
     emit pInputFile->getTableView()->model()->layoutChanged();
 
+    // Like any other edit, so the file on disk matches the position in the history
+    InputFileModel::writeFileOnDisk(pInputFile);
+
+    const CellEditAction& action = group.last();
+
     // Adjust menu items
     pInputFile->getMenus().redo->setEnabled(redoStack->count() > 0);
     pInputFile->getMenus().undo->setEnabled(undoStack->count() > 0);
 
     // Move tableview to the row that was just modified
+    revealRow(pInputFile, action.row());
+}
+
+void TASToolKitEditor::revealRow(InputFile* pInputFile, int rowIdx)
+{
     // Determine if the row is visible on-screen right now
     int rowUpper = pInputFile->getTableView()->rowAt(0);
     int rowLower = pInputFile->getTableView()->rowAt(pInputFile->getTableView()->height());
 
-    if (action.row() < rowUpper || action.row() > rowLower)
-        pInputFile->getTableView()->scrollTo(pInputFile->getTableView()->model()->index(action.row(), 0));
+    if (rowIdx < rowUpper || rowIdx > rowLower)
+        pInputFile->getTableView()->scrollTo(pInputFile->getTableView()->model()->index(rowIdx, 0));
+}
+
+HistoryScrubber* TASToolKitEditor::scrubberFor(InputFile* pInputFile)
+{
+    return (pInputFile == playerFile) ? playerHistoryScrubber : ghostHistoryScrubber;
+}
+
+void TASToolKitEditor::onToggleHistoryTimeline(InputFile* pInputFile, bool bShow)
+{
+    InputFileModel* pModel = (InputFileModel*) pInputFile->getTableView()->model();
+
+    if (!bShow || pModel == nullptr)
+    {
+        if (pModel != nullptr)
+            pModel->endHistoryPreview();
+
+        scrubberFor(pInputFile)->setVisible(false);
+        return;
+    }
+
+    rebuildHistoryTimeline(pInputFile);
+    scrubberFor(pInputFile)->setVisible(true);
+}
+
+void TASToolKitEditor::rebuildHistoryTimeline(InputFile* pInputFile)
+{
+    InputFileModel* pModel = (InputFileModel*) pInputFile->getTableView()->model();
+    pModel->endHistoryPreview();
+    pModel->beginHistoryPreview();
+    scrubberFor(pInputFile)->setSteps(pModel->getTimeline().stepCount(), pModel->getTimeline().fileStep());
+}
+
+void TASToolKitEditor::onHistoryStep(InputFile* pInputFile, int step)
+{
+    InputFileModel* pModel = (InputFileModel*) pInputFile->getTableView()->model();
+
+    // A reload or an edit from another instance since the timeline was laid out
+    if (!pModel->isHistoryPreviewCurrent())
+    {
+        rebuildHistoryTimeline(pInputFile);
+        statusBar()->showMessage("The file changed, so its history timeline was rebuilt", STATUS_MESSAGE_MS);
+        return;
+    }
+
+    int rowIdx = pModel->previewHistoryStep(step);
+    if (rowIdx >= 0)
+        revealRow(pInputFile, rowIdx);
+}
+
+void TASToolKitEditor::restoreHistoryStep(InputFile* pInputFile)
+{
+    InputFileModel* pModel = (InputFileModel*) pInputFile->getTableView()->model();
+
+    if (!pModel->isHistoryPreviewCurrent())
+    {
+        rebuildHistoryTimeline(pInputFile);
+        statusBar()->showMessage("The file changed, so its history timeline was rebuilt", STATUS_MESSAGE_MS);
+        return;
+    }
+
+    QVector<CellEditAction> moved = pModel->restoreHistoryPreview();
+    if (!moved.isEmpty())
+        busFor(pInputFile)->publishCells(moved);
+
+    // Stay open, now with the restored state as the file's own step
+    rebuildHistoryTimeline(pInputFile);
+}
+
+void TASToolKitEditor::closeHistoryTimeline(InputFile* pInputFile)
+{
+    ((pInputFile == playerFile) ? actionHistoryPlayer : actionHistoryGhost)->setChecked(false);
+}
+
+void TASToolKitEditor::closeEvent(QCloseEvent* event)
+{
+    // Keep the undo/redo history of whatever is still open for the next session
+    playerFile->saveHistory();
+    ghostFile->saveHistory();
+
+    QMainWindow::closeEvent(event);
 }
 
 void TASToolKitEditor::closeFile(InputFile* pInputFile)
 {
+    fileWatchService->unwatch(pInputFile->getPath());
+    busFor(pInputFile)->detach();
     pInputFile->closeFile();
     m_filesLoaded--;
     adjustUiOnFileClose(pInputFile);
@@ -192,13 +950,13 @@ bool TASToolKitEditor::userClosedPreviousFile(InputFile* inputFile)
     if (reply != QMessageBox::Yes)
         return false;
 
-    inputFile->closeFile();
+    closeFile(inputFile);
     return true;
 }
 
 void TASToolKitEditor::openFile(InputFile* inputFile)
 {
-    QString filePath = QFileDialog::getOpenFileName(this, "Open File", "", "Input Files (*.csv)");
+    QString filePath = QFileDialog::getOpenFileName(this, "Open File", "", "Input Files (*.csv *.ttkb *.rkg)");
 
     if (inputFile->getPath() != "" && !userClosedPreviousFile(inputFile))
         return;
@@ -208,13 +966,34 @@ void TASToolKitEditor::openFile(InputFile* inputFile)
 
 void TASToolKitEditor::openFile(InputFile* inputFile, QString filePath)
 {
-    if (filePath == playerFile->getPath() || filePath == ghostFile->getPath())
-    {
-        showError("Error Opening File", "This file is already open in the program!");
+    if (fileAlreadyOpen(filePath))
         return;
-    }
 
-    FileStatus status = inputFile->loadFile(filePath);
+    openLoadedFile(inputFile, filePath, InputFile::readFile(filePath, inputFile->getCentering()));
+}
+
+void TASToolKitEditor::openPreloadedFile(QString filePath, const LoadedFile& loaded)
+{
+    InputFile* inputFile = (playerFile->getPath() == "") ? playerFile : ghostFile;
+
+    if (inputFile->getPath() != "" || fileAlreadyOpen(filePath))
+        return;
+
+    openLoadedFile(inputFile, filePath, loaded);
+}
+
+bool TASToolKitEditor::fileAlreadyOpen(const QString& filePath)
+{
+    if (filePath != playerFile->getPath() && filePath != ghostFile->getPath())
+        return false;
+
+    showError("Error Opening File", "This file is already open in the program!");
+    return true;
+}
+
+void TASToolKitEditor::openLoadedFile(InputFile* inputFile, QString filePath, const LoadedFile& loaded)
+{
+    FileStatus status = inputFile->adoptFile(filePath, loaded);
 
     if (status == FileStatus::WritePermission)
     {
@@ -227,16 +1006,118 @@ void TASToolKitEditor::openFile(InputFile* inputFile, QString filePath)
         showError("Error Parsing File", QString("There is an issue with the file on line %1.\n").arg(inputFile->getParseError()));
         return;
     }
+    if (status == FileStatus::Corrupt)
+    {
+        showError("Error Opening File", "This file is damaged or was written by a newer version of this program.");
+        return;
+    }
 
     if (status != FileStatus::Success)
         return;
 
     m_filesLoaded++;
 
+    inputFile->restoreHistory();
     adjustUiOnFileLoad(inputFile);
 
-    connect(inputFile->getFsWatcher(), &QFileSystemWatcher::fileChanged, this, [inputFile]{ inputFile->fileChanged(); });
-    connect(inputFile->getTableView(), &QTableView::clicked, this, [inputFile](const QModelIndex& index) { inputFile->onCellClicked(index); });
+    fileWatchService->watch(filePath);
+    busFor(inputFile)->attach();
+}
+
+void TASToolKitEditor::onReloadDue(const QString& filePath)
+{
+    InputFile* pInputFile = (filePath == playerFile->getPath()) ? playerFile : ghostFile;
+
+    if (pInputFile->getPath() != filePath)
+        return;
+
+    // A save by the instance hosting the edit bus, or a change it already shared, is what this
+    // one has from the bus. Anything else came from outside and is picked up like any change.
+    if (pInputFile->hasRemoteWriter())
+    {
+        quint64 hash;
+        if (pInputFile->contentHashOnDisk(&hash) && (hash == busFor(pInputFile)->hostDiskHash() || hash == pInputFile->getContentHash()))
+        {
+            pInputFile->noteWrittenToDisk(hash);
+            return;
+        }
+    }
+
+    EditBus* pBus = busFor(pInputFile);
+    bool bHost = pBus->isAttached() && !pInputFile->hasRemoteWriter();
+
+    // A followed file that only grew reads just the new lines; anything else is reloaded in full
+    if (pInputFile->isFollowingTail())
+    {
+        TailStatus status = ((InputFileModel*) pInputFile->getTableView()->model())->followAppends();
+
+        if (status == TailStatus::Unchanged)
+            return;
+
+        if (status == TailStatus::Appended)
+        {
+            if (bHost)
+                pBus->publishReloaded(pInputFile->getContentHash());
+            if (actionAutoScrollAppends->isChecked())
+                pInputFile->getTableView()->scrollToBottom();
+            return;
+        }
+    }
+
+    if (!pInputFile->fileChanged())
+        return;
+
+    // Everyone else on the bus follows the host to what it just read
+    if (bHost && pInputFile->getPath() != "")
+        pBus->publishReloaded(pInputFile->getContentHash());
+
+    // The reloaded file failed to parse and was dropped
+    if (pInputFile->getPath() == "")
+        fileWatchService->unwatch(filePath);
+
+    emit pInputFile->getTableView()->model()->layoutChanged();
+}
+
+void TASToolKitEditor::exportFile(InputFile* pInputFile)
+{
+    QString filePath = QFileDialog::getSaveFileName(this, "Export As", "", "Input Files (*.csv *.ttkb *.rkg)");
+
+    if (filePath == "")
+        return;
+
+    if (InputFileModel::writeFrames(filePath, pInputFile->getData(), pInputFile->getCentering()))
+        return;
+
+    if (RkgFile::isRkgPath(filePath))
+        showError("Error Exporting File", "The inputs could not be written as a ghost. Either they change too often to fit in a ghost file, " \
+            "or this program does not have sufficient permissions to write the selected file.");
+    else
+        showError("Error Exporting File", "This program does not have sufficient permissions to write the selected file.");
+}
+
+void TASToolKitEditor::convertFile()
+{
+    QString srcPath = QFileDialog::getOpenFileName(this, "Convert File", "", "Input Files (*.csv *.ttkb)");
+
+    if (srcPath == "")
+        return;
+
+    bool bToCsv = TtkbFile::isTtkbPath(srcPath);
+    QString dstFilter = bToCsv ? "CSV Files (*.csv)" : "Binary Input Files (*.ttkb)";
+    QString dstPath = QFileDialog::getSaveFileName(this, "Save Converted File", "", dstFilter);
+
+    if (dstPath == "")
+        return;
+
+    int errorLine = 0;
+    FileStatus status = bToCsv ? TtkbFile::ttkbToCsv(srcPath, dstPath) : TtkbFile::csvToTtkb(srcPath, dstPath, &errorLine);
+
+    if (status == FileStatus::WritePermission)
+        showError("Error Converting File", "This program does not have sufficient permissions to read the source or write the destination.");
+    else if (status == FileStatus::Parse)
+        showError("Error Parsing File", QString("There is an issue with the file on line %1.\n").arg(errorLine));
+    else if (status == FileStatus::Corrupt)
+        showError("Error Converting File", "This file is damaged or was written by a newer version of this program.");
 }
 
 void TASToolKitEditor::adjustUiOnFileLoad(InputFile* pInputFile)
@@ -244,12 +1125,68 @@ void TASToolKitEditor::adjustUiOnFileLoad(InputFile* pInputFile)
     adjustInputCenteringMenu(pInputFile);
     pInputFile->getMenus().root->menuAction()->setVisible(true);
     pInputFile->getMenus().close->setEnabled(true);
+    pInputFile->getMenus().undo->setEnabled(pInputFile->getUndoStack()->count() > 0);
+    pInputFile->getMenus().redo->setEnabled(pInputFile->getRedoStack()->count() > 0);
     pInputFile->getLabel()->setVisible(true);
 
     QTableView* pTable = pInputFile->getTableView();
-    pTable->setModel(new InputFileModel(pInputFile));
+    InputFileModel* pModel = new InputFileModel(pInputFile);
+    QItemSelectionModel* pOldSelection = pTable->selectionModel();
+    pTable->setModel(pModel);
+
+    // The view doesn't delete selection models it is done with
+    QItemSelectionModel* pDefaultSelection = pTable->selectionModel();
+    pTable->setSelectionModel(new FrameSelectionModel(pModel, pModel));
+    delete pDefaultSelection;
+    delete pOldSelection;
     pTable->setVisible(true);
 
+    connect(pTable->selectionModel(), &QItemSelectionModel::selectionChanged, this, [this, pInputFile]() { updateStatsPanel(pInputFile); });
+    connect(pTable->model(), &QAbstractItemModel::dataChanged, this, [this, pInputFile](const QModelIndex&, const QModelIndex&, const QVector<int>& roles)
+    {
+        // Cursor highlight changes don't touch the data
+        if (roles.count() != 1 || roles[0] != Qt::BackgroundRole)
+            updateStatsPanel(pInputFile);
+    });
+    connect(pTable->model(), &QAbstractItemModel::layoutChanged, this, [this, pInputFile]() { updateStatsPanel(pInputFile); });
+    connect(pTable->model(), &QAbstractItemModel::rowsInserted, this, [this, pInputFile]() { updateStatsPanel(pInputFile); });
+
+    FrameMinimap* pMinimap = minimapFor(pInputFile);
+    pMinimap->setFile(pInputFile);
+    pMinimap->setVisible(true);
+    connect(pTable->model(), &QAbstractItemModel::dataChanged, pMinimap, [pMinimap]() { pMinimap->update(); });
+    connect(pTable->model(), &QAbstractItemModel::layoutChanged, pMinimap, [pMinimap]() { pMinimap->update(); });
+    connect(pTable->model(), &QAbstractItemModel::rowsInserted, pMinimap, [pMinimap]() { pMinimap->update(); });
+
+    InputPlot* pPlot = plotFor(pInputFile);
+    pPlot->setFile(pInputFile);
+    pPlot->setVisible(actionShowPlots->isChecked());
+    connect(pTable->selectionModel(), &QItemSelectionModel::selectionChanged, this, [this, pInputFile]() { updatePlotRange(pInputFile); });
+    connect(pTable->model(), &QAbstractItemModel::dataChanged, pPlot, [pPlot](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles)
+    {
+        if (roles.count() != 1 || roles[0] != Qt::BackgroundRole)
+            pPlot->rowsChanged(topLeft.row(), bottomRight.row());
+    });
+    connect(pTable->model(), &QAbstractItemModel::layoutChanged, this, [this, pInputFile, pPlot]()
+    {
+        pPlot->invalidate();
+        updatePlotRange(pInputFile);
+    });
+    connect(pTable->model(), &QAbstractItemModel::rowsInserted, this, [this, pInputFile]() { updatePlotRange(pInputFile); });
+    updatePlotRange(pInputFile);
+    connect((InputFileModel*) pTable->model(), &InputFileModel::cellEdited, this, [this, pInputFile](int rowIdx, int colIdx, int value)
+    {
+        recordMacroEdit(pInputFile, rowIdx, colIdx, value);
+        busFor(pInputFile)->publishCell(rowIdx, colIdx, value);
+    });
+    connect((InputFileModel*) pTable->model(), &InputFileModel::centeringChanged, this, [this, pInputFile]() { adjustInputCenteringMenu(pInputFile); });
+    connect((InputFileModel*) pTable->model(), &InputFileModel::fileWritten, busFor(pInputFile), &EditBus::publishWritten);
+    connect((InputFileModel*) pTable->model(), &InputFileModel::framesEdited, this, [this, pInputFile](int firstRow, int count)
+    {
+        busFor(pInputFile)->publishRange(firstRow, count);
+    });
+    updateStatsPanel(pInputFile);
+
     /* This stuff really should be constant, but I can't do any of this until
     // the model is set, but I can't set the model until I instantiate the model
     // instance, but I can't instantiate the instance until I have the InputFile
@@ -258,25 +1195,28 @@ void TASToolKitEditor::adjustUiOnFileLoad(InputFile* pInputFile)
     // THIS IS SO CONFUSING!*/
     pTable->setColumnWidth(0, FRAMECOUNT_COLUMN_WIDTH);
 
-    for (int i = 0; i < 3; i++)
-        pTable->setColumnWidth(i + FRAMECOUNT_COLUMN, BUTTON_COLUMN_WIDTH);
-
-    for (int i = 3; i < NUM_INPUT_COLUMNS - 1; i++)
-        pTable->setColumnWidth(i + FRAMECOUNT_COLUMN, STICK_COLUMN_WIDTH);
-
-    pTable->setColumnWidth(NUM_INPUT_COLUMNS - 1 + FRAMECOUNT_COLUMN, PAD_COLUMN_WIDTH);
+    for (int i = 0; i < NUM_INPUT_COLUMNS; i++)
+        pTable->setColumnWidth(i + FRAMECOUNT_COLUMN, TTK_COLUMNS[i].width);
 
     if (m_filesLoaded == 2)
     {
         actionSwapFiles->setEnabled(true);
         actionScrollTogether->setEnabled(true);
+        actionAlignFiles->setEnabled(true);
+        actionAlignSegments->setEnabled(true);
         resize(width() * 2, height());
     }
 }
 
 void TASToolKitEditor::adjustUiOnFileClose(InputFile* pInputFile)
 {
-    resize(SINGLE_FILE_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
+    closeHistoryTimeline(pInputFile);
+    (pInputFile == playerFile ? playerStatsLabel : ghostStatsLabel)->setVisible(false);
+    minimapFor(pInputFile)->setFile(nullptr);
+    minimapFor(pInputFile)->setVisible(false);
+    plotFor(pInputFile)->setFile(nullptr);
+    plotFor(pInputFile)->setVisible(false);
+    resize(SINGLE_FILE_WINDOW_WIDTH, windowHeight());
 
     adjustMenuOnClose(pInputFile);
 }
@@ -301,12 +1241,17 @@ void TASToolKitEditor::adjustMenuOnClose(InputFile* inputFile)
     m_bScrollTogether = false;
     actionScrollTogether->setEnabled(false);
     actionScrollTogether->setChecked(false);
+    actionAlignFiles->setEnabled(false);
+    actionAlignSegments->setEnabled(false);
+    m_alignment.clear();
+    actionClearAlignment->setEnabled(false);
 }
 
 void TASToolKitEditor::setTableViewSettings(QTableView* pTable)
 {
     pTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     pTable->horizontalHeader()->setMinimumSectionSize(0); // prevents minimum column size enforcement
+    pTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     pTable->setVisible(false);
 }
 
@@ -322,6 +1267,7 @@ void TASToolKitEditor::addMenuItems()
     addFileMenuItems();
     addPlayerMenuItems();
     addGhostMenuItems();
+    addMacroMenuItems();
 }
 
 void TASToolKitEditor::addFileMenuItems()
@@ -339,15 +1285,72 @@ void TASToolKitEditor::addFileMenuItems()
     actionScrollTogether->setEnabled(false);
     actionScrollTogether->setCheckable(true);
     actionScrollTogether->setChecked(false);
+    actionConvertFile = new QAction(this);
+    actionFollowEmulator = new QAction(this);
+    actionFollowEmulator->setCheckable(true);
+    actionFollowEmulator->setChecked(false);
+    actionShowPlots = new QAction(this);
+    actionShowPlots->setCheckable(true);
+    actionShowPlots->setChecked(false);
+    actionFollowAppends = new QAction(this);
+    actionFollowAppends->setCheckable(true);
+    actionFollowAppends->setChecked(false);
+    actionAutoScrollAppends = new QAction(this);
+    actionAutoScrollAppends->setCheckable(true);
+    actionAutoScrollAppends->setChecked(true);
+    actionAutoScrollAppends->setEnabled(false);
+    actionAlignFiles = new QAction(this);
+    actionAlignFiles->setEnabled(false);
+    actionAlignSegments = new QAction(this);
+    actionAlignSegments->setEnabled(false);
+    actionClearAlignment = new QAction(this);
+    actionClearAlignment->setEnabled(false);
     menuFile->addAction(actionOpenPlayer);
     menuFile->addAction(actionOpenGhost);
     menuFile->addAction(actionClosePlayer);
     menuFile->addAction(actionCloseGhost);
     menuFile->addAction(actionSwapFiles);
     menuFile->addAction(actionScrollTogether);
+    menuFile->addAction(actionAlignFiles);
+    menuFile->addAction(actionAlignSegments);
+    menuFile->addAction(actionClearAlignment);
+    menuFile->addAction(actionConvertFile);
+    menuFile->addAction(actionFollowEmulator);
+    menuFile->addAction(actionShowPlots);
+    menuFile->addAction(actionFollowAppends);
+    menuFile->addAction(actionAutoScrollAppends);
+#ifdef TTK_TRACING
+    actionExportTrace = new QAction(this);
+    menuFile->addAction(actionExportTrace);
+#endif
     menuBar->addAction(menuFile->menuAction());
 }
 
+void TASToolKitEditor::addMacroMenuItems()
+{
+    menuMacros = new QMenu(menuBar);
+    actionRecordMacro = new QAction(this);
+    actionRecordMacro->setCheckable(true);
+    actionRecordMacro->setChecked(false);
+    actionDeleteMacro = new QAction(this);
+    menuMacros->addAction(actionRecordMacro);
+    menuMacros->addAction(actionDeleteMacro);
+    menuBar->addAction(menuMacros->menuAction());
+}
+
+void TASToolKitEditor::deleteMacro()
+{
+    QStringList names = EditMacro::savedNames();
+    if (names.isEmpty())
+        return;
+
+    bool bOk = false;
+    QString name = QInputDialog::getItem(this, "Delete Macro", "Macro:", names, 0, false, &bOk);
+
+    if (bOk)
+        EditMacro::remove(name);
+}
+
 void TASToolKitEditor::addPlayerMenuItems()
 {
     menuPlayer = new QMenu(menuBar);
@@ -356,16 +1359,33 @@ void TASToolKitEditor::addPlayerMenuItems()
     actionUndoPlayer->setEnabled(false);
     actionRedoPlayer = new QAction(this);
     actionRedoPlayer->setEnabled(false);
+    actionHistoryPlayer = new QAction(this);
+    actionHistoryPlayer->setCheckable(true);
     action0CenteredPlayer = new QAction(this);
     action0CenteredPlayer->setCheckable(true);
     action7CenteredPlayer = new QAction(this);
     action7CenteredPlayer->setCheckable(true);
+    actionExportPlayer = new QAction(this);
+    actionTransformPlayer = new QAction(this);
+    actionPlayMacroPlayer = new QAction(this);
+    actionCopyPlayer = new QAction(this);
+    actionCutPlayer = new QAction(this);
+    actionPastePlayer = new QAction(this);
     menuCenterPlayer = new QMenu(menuFile);
     menuCenterPlayer->addAction(action0CenteredPlayer);
     menuCenterPlayer->addAction(action7CenteredPlayer);
     menuPlayer->addAction(actionUndoPlayer);
     menuPlayer->addAction(actionRedoPlayer);
+    menuPlayer->addAction(actionHistoryPlayer);
+    menuPlayer->addSeparator();
+    menuPlayer->addAction(actionCutPlayer);
+    menuPlayer->addAction(actionCopyPlayer);
+    menuPlayer->addAction(actionPastePlayer);
+    menuPlayer->addSeparator();
     menuPlayer->addAction(menuCenterPlayer->menuAction());
+    menuPlayer->addAction(actionExportPlayer);
+    menuPlayer->addAction(actionTransformPlayer);
+    menuPlayer->addAction(actionPlayMacroPlayer);
     menuBar->addAction(menuPlayer->menuAction());
 }
 
@@ -377,17 +1397,34 @@ void TASToolKitEditor::addGhostMenuItems()
     actionUndoGhost->setEnabled(false);
     actionRedoGhost = new QAction(this);
     actionRedoGhost->setEnabled(false);
+    actionHistoryGhost = new QAction(this);
+    actionHistoryGhost->setCheckable(true);
     action0CenteredGhost = new QAction(this);
     action0CenteredGhost->setCheckable(true);
     action7CenteredGhost = new QAction(this);
     action7CenteredGhost->setCheckable(true);
+    actionExportGhost = new QAction(this);
+    actionTransformGhost = new QAction(this);
+    actionPlayMacroGhost = new QAction(this);
+    actionCopyGhost = new QAction(this);
+    actionCutGhost = new QAction(this);
+    actionPasteGhost = new QAction(this);
     menuCenterGhost = new QMenu(menuFile);
     menuCenterGhost->addAction(action0CenteredGhost);
     menuCenterGhost->addAction(action7CenteredGhost);
 
     menuGhost->addAction(actionUndoGhost);
     menuGhost->addAction(actionRedoGhost);
+    menuGhost->addAction(actionHistoryGhost);
+    menuGhost->addSeparator();
+    menuGhost->addAction(actionCutGhost);
+    menuGhost->addAction(actionCopyGhost);
+    menuGhost->addAction(actionPasteGhost);
+    menuGhost->addSeparator();
     menuGhost->addAction(menuCenterGhost->menuAction());
+    menuGhost->addAction(actionExportGhost);
+    menuGhost->addAction(actionTransformGhost);
+    menuGhost->addAction(actionPlayMacroGhost);
     menuBar->addAction(menuGhost->menuAction());
 }
 
@@ -414,8 +1451,28 @@ void TASToolKitEditor::setupUi()
 
     playerTableView = new QTableView(horizontalLayoutWidget);
     setTableViewSettings(playerTableView);
+    playerTableView->addActions({ actionCutPlayer, actionCopyPlayer, actionPastePlayer });
+
+    playerMinimap = new FrameMinimap(horizontalLayoutWidget);
+    playerMinimap->setVisible(false);
+
+    QHBoxLayout* playerTableHLayout = new QHBoxLayout();
+    playerTableHLayout->setSpacing(TABLE_MINIMAP_SPACING);
+    playerTableHLayout->addWidget(playerTableView);
+    playerTableHLayout->addWidget(playerMinimap);
+    playerVLayout->addLayout(playerTableHLayout);
 
-    playerVLayout->addWidget(playerTableView);
+    playerHistoryScrubber = new HistoryScrubber(horizontalLayoutWidget);
+    playerHistoryScrubber->setVisible(false);
+    playerVLayout->addWidget(playerHistoryScrubber);
+
+    playerStatsLabel = new QLabel(horizontalLayoutWidget);
+    playerStatsLabel->setVisible(false);
+    playerVLayout->addWidget(playerStatsLabel);
+
+    playerPlot = new InputPlot(horizontalLayoutWidget);
+    playerPlot->setVisible(false);
+    playerVLayout->addWidget(playerPlot);
 
     mainHorizLayout->addLayout(playerVLayout);
 
@@ -427,8 +1484,28 @@ void TASToolKitEditor::setupUi()
 
     ghostTableView = new QTableView(horizontalLayoutWidget);
     setTableViewSettings(ghostTableView);
+    ghostTableView->addActions({ actionCutGhost, actionCopyGhost, actionPasteGhost });
+
+    ghostMinimap = new FrameMinimap(horizontalLayoutWidget);
+    ghostMinimap->setVisible(false);
+
+    QHBoxLayout* ghostTableHLayout = new QHBoxLayout();
+    ghostTableHLayout->setSpacing(TABLE_MINIMAP_SPACING);
+    ghostTableHLayout->addWidget(ghostTableView);
+    ghostTableHLayout->addWidget(ghostMinimap);
+    ghostVLayout->addLayout(ghostTableHLayout);
 
-    ghostVLayout->addWidget(ghostTableView);
+    ghostHistoryScrubber = new HistoryScrubber(horizontalLayoutWidget);
+    ghostHistoryScrubber->setVisible(false);
+    ghostVLayout->addWidget(ghostHistoryScrubber);
+
+    ghostStatsLabel = new QLabel(horizontalLayoutWidget);
+    ghostStatsLabel->setVisible(false);
+    ghostVLayout->addWidget(ghostStatsLabel);
+
+    ghostPlot = new InputPlot(horizontalLayoutWidget);
+    ghostPlot->setVisible(false);
+    ghostVLayout->addWidget(ghostPlot);
 
     mainHorizLayout->addLayout(ghostVLayout);
 
@@ -436,6 +1513,21 @@ void TASToolKitEditor::setupUi()
 
     m_filesLoaded = 0;
     m_bScrollTogether = false;
+    m_bSyncingScroll = false;
+
+    alignPollTimer = new QTimer(this);
+    alignPollTimer->setInterval(ALIGN_POLL_MS);
+    connect(alignPollTimer, &QTimer::timeout, this, &TASToolKitEditor::onAlignPoll);
+
+    frameCursorReader = new FrameCursorReader(this);
+    fileWatchService = new FileWatchService(this);
+
+#ifdef TTK_TRACING
+    traceOverlayLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(traceOverlayLabel);
+    traceOverlayTimer = new QTimer(this);
+    traceOverlayTimer->start(TRACE_OVERLAY_INTERVAL_MS);
+#endif
 
     setTitles();
 }
@@ -453,6 +1545,14 @@ void TASToolKitEditor::setTitleNames()
     actionRedoPlayer->setText("Redo");
     actionUndoGhost->setText("Undo");
     actionRedoGhost->setText("Redo");
+    actionHistoryPlayer->setText("History Timeline");
+    actionHistoryGhost->setText("History Timeline");
+    actionCopyPlayer->setText("Copy Frames");
+    actionCopyGhost->setText("Copy Frames");
+    actionCutPlayer->setText("Cut Frames");
+    actionCutGhost->setText("Cut Frames");
+    actionPastePlayer->setText("Paste Frames");
+    actionPasteGhost->setText("Paste Frames");
     actionOpenPlayer->setText("Open Player");
     actionOpenGhost->setText("Open Ghost");
     actionClosePlayer->setText("Close Player");
@@ -463,6 +1563,25 @@ void TASToolKitEditor::setTitleNames()
     action7CenteredPlayer->setText("7 Centered");
     actionSwapFiles->setText("Swap Player and Ghost");
     actionScrollTogether->setText("Scroll Together");
+    actionConvertFile->setText("Convert CSV/TTKB...");
+    actionFollowEmulator->setText("Follow Emulator Frame");
+    actionShowPlots->setText("Show Input Plots");
+    actionFollowAppends->setText("Follow File Appends");
+    actionAutoScrollAppends->setText("Scroll to Appended Frames");
+    actionAlignFiles->setText("Align Ghost to Player");
+    actionAlignSegments->setText("Align Ghost to Player by Segment...");
+    actionClearAlignment->setText("Clear Alignment");
+    actionExportPlayer->setText("Export As...");
+    actionExportGhost->setText("Export As...");
+    actionTransformPlayer->setText("Run Transform...");
+    actionTransformGhost->setText("Run Transform...");
+    actionPlayMacroPlayer->setText("Play Macro...");
+    actionPlayMacroGhost->setText("Play Macro...");
+    actionRecordMacro->setText("Record Macro");
+    actionDeleteMacro->setText("Delete Macro...");
+#ifdef TTK_TRACING
+    actionExportTrace->setText("Export Trace...");
+#endif
     playerLabel->setText("Player");
     ghostLabel->setText("Ghost");
     menuFile->setTitle("File");
@@ -470,6 +1589,7 @@ void TASToolKitEditor::setTitleNames()
     menuCenterPlayer->setTitle("Input Centering");
     menuPlayer->setTitle("Player");
     menuGhost->setTitle("Ghost");
+    menuMacros->setTitle("Macros");
 }
 
 void TASToolKitEditor::setTitleShortcuts()
@@ -483,5 +1603,16 @@ void TASToolKitEditor::setTitleShortcuts()
     actionOpenGhost->setShortcut(QString("Ctrl+Shift+O"));
     actionClosePlayer->setShortcut(QString("Esc"));
     actionCloseGhost->setShortcut(QString("Shift+Esc"));
+
+    // Both tables use the standard clipboard keys, so each only answers while its table has focus
+    for (QAction* pAction : { actionCopyPlayer, actionCutPlayer, actionPastePlayer, actionCopyGhost, actionCutGhost, actionPasteGhost })
+        pAction->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+
+    actionCopyPlayer->setShortcut(QKeySequence::Copy);
+    actionCutPlayer->setShortcut(QKeySequence::Cut);
+    actionPastePlayer->setShortcut(QKeySequence::Paste);
+    actionCopyGhost->setShortcut(QKeySequence::Copy);
+    actionCutGhost->setShortcut(QKeySequence::Cut);
+    actionPasteGhost->setShortcut(QKeySequence::Paste);
 #endif
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QElapsedTimer>
 #include <Qstack>
 #include <QStyledItemDelegate>
 #include <QVector>
@@ -21,7 +22,22 @@
 
 #include <QtWidgets/QMainWindow>
 
+#include "EditMacro.h"
+#include "FrameAlign.h"
+
+#include <future>
+
+class EditBus;
+class FileWatchService;
+class FrameRanges;
+class FrameMinimap;
+class HistoryScrubber;
+class InputPlot;
+class FrameCursorReader;
 class InputFile;
+struct LoadedFile;
+class QCloseEvent;
+class QTimer;
 enum class EOperationType;
 enum class Centering;
 
@@ -32,11 +48,25 @@ class TASToolKitEditor : public QMainWindow
 public:
     TASToolKitEditor(QWidget *parent = Q_NULLPTR);
 
+    // Opens an already-read file (e.g. from the command line) as the player, or the ghost if a player is open
+    void openPreloadedFile(QString filePath, const LoadedFile& loaded);
+
+protected:
+    void closeEvent(QCloseEvent* event) override;
+
 private:
     QAction* actionUndoPlayer;
     QAction* actionRedoPlayer;
     QAction* actionUndoGhost;
     QAction* actionRedoGhost;
+    QAction* actionHistoryPlayer;
+    QAction* actionHistoryGhost;
+    QAction* actionCopyPlayer;
+    QAction* actionCutPlayer;
+    QAction* actionPastePlayer;
+    QAction* actionCopyGhost;
+    QAction* actionCutGhost;
+    QAction* actionPasteGhost;
     QAction* actionOpenPlayer;
     QAction* actionOpenGhost;
     QAction* actionClosePlayer;
@@ -47,27 +77,73 @@ private:
     QAction* action7CenteredGhost;
     QAction* actionSwapFiles;
     QAction* actionScrollTogether;
+    QAction* actionConvertFile;
+    QAction* actionExportPlayer;
+    QAction* actionExportGhost;
+    QAction* actionTransformPlayer;
+    QAction* actionTransformGhost;
+    QAction* actionPlayMacroPlayer;
+    QAction* actionPlayMacroGhost;
+    QAction* actionRecordMacro;
+    QAction* actionDeleteMacro;
+    QAction* actionFollowEmulator;
+    QAction* actionShowPlots;
+    QAction* actionFollowAppends;
+    QAction* actionAutoScrollAppends;
+    QAction* actionAlignFiles;
+    QAction* actionAlignSegments;
+    QAction* actionClearAlignment;
+    FrameCursorReader* frameCursorReader;
+    FileWatchService* fileWatchService;
+    EditBus* playerBus;
+    EditBus* ghostBus;
+#ifdef TTK_TRACING
+    QAction* actionExportTrace;
+    QLabel* traceOverlayLabel;
+    QTimer* traceOverlayTimer;
+#endif
     QWidget* centralWidget;
     QWidget* horizontalLayoutWidget;
     QHBoxLayout* mainHorizLayout;
     QVBoxLayout* playerVLayout;
     QLabel* playerLabel;
     QTableView* playerTableView;
+    QLabel* playerStatsLabel;
+    FrameMinimap* playerMinimap;
+    HistoryScrubber* playerHistoryScrubber;
+    InputPlot* playerPlot;
     QVBoxLayout* ghostVLayout;
     QLabel* ghostLabel;
     QTableView* ghostTableView;
+    QLabel* ghostStatsLabel;
+    FrameMinimap* ghostMinimap;
+    HistoryScrubber* ghostHistoryScrubber;
+    InputPlot* ghostPlot;
     QMenuBar* menuBar;
     QMenu* menuFile;
     QMenu* menuCenterPlayer;
     QMenu* menuCenterGhost;
     QMenu* menuPlayer;
     QMenu* menuGhost;
+    QMenu* menuMacros;
 
     InputFile* playerFile;
     InputFile* ghostFile;
 
     int m_filesLoaded;
     bool m_bScrollTogether;
+    bool m_bSyncingScroll;
+    FrameAlign m_alignment;
+    std::future<FrameAlign> m_alignTask;
+    QElapsedTimer m_alignClock;
+    QString m_alignPlayerPath;
+    QString m_alignGhostPath;
+    quint64 m_alignPlayerVersion;
+    quint64 m_alignGhostVersion;
+    QTimer* alignPollTimer;
+    QString m_lastTransformScript;
+    EditMacro m_recordingMacro;
+    InputFile* m_pMacroSource;
 
     void setupUi();
     void setTitles();
@@ -78,6 +154,7 @@ private:
     void addFileMenuItems();
     void addPlayerMenuItems();
     void addGhostMenuItems();
+    void addMacroMenuItems();
     void createInputFileInstances();
     void showError(const QString& errTitle, const QString& errMsg);
     bool userClosedPreviousFile(InputFile* inputFile);
@@ -89,10 +166,55 @@ private:
 
     void openFile(InputFile* inputFile);
     void openFile(InputFile* inputFile, QString filePath);
+    void openLoadedFile(InputFile* inputFile, QString filePath, const LoadedFile& loaded);
+    bool fileAlreadyOpen(const QString& filePath);
     void closeFile(InputFile* pInputFile);
+    void onReloadDue(const QString& filePath);
+    void exportFile(InputFile* pInputFile);
+    void convertFile();
     void onUndoRedo(InputFile* pInputFile, EOperationType opType);
+    void revealRow(InputFile* pInputFile, int rowIdx);
+    HistoryScrubber* scrubberFor(InputFile* pInputFile);
+    void onToggleHistoryTimeline(InputFile* pInputFile, bool bShow);
+    void rebuildHistoryTimeline(InputFile* pInputFile);
+    void onHistoryStep(InputFile* pInputFile, int step);
+    void restoreHistoryStep(InputFile* pInputFile);
+    void closeHistoryTimeline(InputFile* pInputFile);
     void onScroll(InputFile* pInputFile);
+    void jumpToRow(InputFile* pInputFile, int rowIdx);
+    FrameMinimap* minimapFor(InputFile* pInputFile);
+    EditBus* busFor(InputFile* pInputFile);
+    void connectEditBus(InputFile* pInputFile);
+    void resyncFromDisk(InputFile* pInputFile);
+    bool recenterFile(InputFile* pInputFile, Centering centering);
+    InputPlot* plotFor(InputFile* pInputFile);
+    int windowHeight();
+    void onToggleShowPlots(bool bShow);
+    void updatePlotRange(InputFile* pInputFile);
     void onToggleScrollTogether(bool bTogether);
+    void alignFiles(int segmentLength);
+    void alignFilesBySegment();
+    void onAlignPoll();
+    void clearAlignment();
     void onReCenter(InputFile* pInputFile, Centering centering);
     void scrollToFirstTable(QTableView* dst, QTableView* src);
+    void updateStatsPanel(InputFile* pInputFile);
+    void selectedRowSpan(InputFile* pInputFile, int* pFirstRow, int* pLastRow);
+    FrameRanges selectedFrames(InputFile* pInputFile);
+    void copyFrames(InputFile* pInputFile);
+    void cutFrames(InputFile* pInputFile);
+    void pasteFrames(InputFile* pInputFile);
+    void runTransform(InputFile* pInputFile);
+    void onToggleRecordMacro(bool bRecord);
+    void recordMacroEdit(InputFile* pInputFile, int rowIdx, int colIdx, int value);
+    void playMacro(InputFile* pInputFile);
+    void deleteMacro();
+    void onToggleFollowAppends(bool bFollow);
+    void onToggleFollowEmulator(bool bFollow);
+    void onFrameCursor(int playerFrame, int ghostFrame);
+    void moveCursorRow(InputFile* pInputFile, int frame);
+#ifdef TTK_TRACING
+    void exportTrace();
+    void updateTraceOverlay();
+#endif
 };
\ No newline at end of file
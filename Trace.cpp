@@ -0,0 +1,133 @@
+#include "Trace.h"
+
+#ifdef TTK_TRACING
+
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#define NO_PENDING_EDIT -1
+
+static quint32 currentThreadIndex()
+{
+    static std::atomic<quint32> s_nextThreadIndex(1);
+    thread_local quint32 t_threadIndex = s_nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+    return t_threadIndex;
+}
+
+TraceBuffer& TraceBuffer::instance()
+{
+    static TraceBuffer s_instance;
+    return s_instance;
+}
+
+qint64 TraceBuffer::nowNs()
+{
+    static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+TraceBuffer::TraceBuffer()
+    : m_next(0)
+    , m_editStartNs(NO_PENDING_EDIT)
+    , m_latencyCount(0)
+    , m_latencyNext(0)
+{
+    for (int i = 0; i < TRACE_CAPACITY; i++)
+        m_events[i].seq.store(0, std::memory_order_relaxed);
+}
+
+void TraceBuffer::record(const char* name, qint64 startNs, qint64 durationNs)
+{
+    quint64 ticket = m_next.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& event = m_events[ticket % TRACE_CAPACITY];
+
+    // Zero marks the slot as being written; the final sequence is ticket + 1
+    event.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.durationNs.store(durationNs, std::memory_order_relaxed);
+    event.threadId.store(currentThreadIndex(), std::memory_order_relaxed);
+    event.seq.store(ticket + 1, std::memory_order_release);
+}
+
+bool TraceBuffer::exportChromeTrace(const QString& path) const
+{
+    QSaveFile fp(path);
+    if (!fp.open(QIODevice::WriteOnly))
+        return false;
+
+    QTextStream ts(&fp);
+    ts << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    quint64 end = m_next.load(std::memory_order_acquire);
+    quint64 begin = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    bool bFirst = true;
+
+    for (quint64 ticket = begin; ticket < end; ticket++)
+    {
+        const TraceEvent& event = m_events[ticket % TRACE_CAPACITY];
+
+        if (event.seq.load(std::memory_order_acquire) != ticket + 1)
+            continue;
+
+        const char* name = event.name.load(std::memory_order_relaxed);
+        qint64 startNs = event.startNs.load(std::memory_order_relaxed);
+        qint64 durationNs = event.durationNs.load(std::memory_order_relaxed);
+        quint32 threadId = event.threadId.load(std::memory_order_relaxed);
+
+        // Skip the slot if a writer lapped us while it was being read
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.seq.load(std::memory_order_relaxed) != ticket + 1)
+            continue;
+
+        if (!bFirst)
+            ts << ",";
+        bFirst = false;
+
+        ts << "{\"name\":\"" << name << "\",\"cat\":\"ttk\",\"ph\":\"X\",\"pid\":1"
+           << ",\"tid\":" << threadId
+           << ",\"ts\":" << QString::number(startNs / 1000.0, 'f', 3)
+           << ",\"dur\":" << QString::number(durationNs / 1000.0, 'f', 3) << "}";
+    }
+
+    ts << "]}\n";
+    ts.flush();
+
+    return fp.commit();
+}
+
+void TraceBuffer::markEditStart()
+{
+    if (m_editStartNs == NO_PENDING_EDIT)
+        m_editStartNs = nowNs();
+}
+
+void TraceBuffer::markEditOnDisk()
+{
+    if (m_editStartNs == NO_PENDING_EDIT)
+        return;
+
+    m_latencies[m_latencyNext] = nowNs() - m_editStartNs;
+    m_latencyNext = (m_latencyNext + 1) % LATENCY_CAPACITY;
+    m_latencyCount = std::min(m_latencyCount + 1, LATENCY_CAPACITY);
+    m_editStartNs = NO_PENDING_EDIT;
+}
+
+qint64 TraceBuffer::latencyPercentileNs(int percentile) const
+{
+    if (m_latencyCount == 0)
+        return 0;
+
+    std::vector<qint64> samples(m_latencies, m_latencies + m_latencyCount);
+    size_t rank = (samples.size() - 1) * percentile / 100;
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+
+    return samples[rank];
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+// Scoped trace spans and edit-to-disk latency tracking. Everything here is only
+// compiled in when TTK_TRACING is defined; otherwise the macros expand to nothing.
+
+#ifdef TTK_TRACING
+
+#include <QString>
+
+#include <atomic>
+
+#define TRACE_CAPACITY (1 << 16)
+#define LATENCY_CAPACITY 1024
+
+// The payload is atomic too (accessed relaxed) since the exporter may read a slot while a
+// writer that wrapped around is rewriting it; seq tells it afterwards whether to keep the copy
+struct TraceEvent
+{
+    std::atomic<quint64> seq;
+    std::atomic<const char*> name;
+    std::atomic<qint64> startNs;
+    std::atomic<qint64> durationNs;
+    std::atomic<quint32> threadId;
+};
+
+// Fixed-size ring of completed spans. Writers claim a slot with a single atomic
+// increment and publish it through the slot's sequence number, so recording never
+// blocks; when the ring wraps the oldest spans are overwritten.
+class TraceBuffer
+{
+public:
+    static TraceBuffer& instance();
+    static qint64 nowNs();
+
+    void record(const char* name, qint64 startNs, qint64 durationNs);
+    bool exportChromeTrace(const QString& path) const;
+
+    // Edit-to-disk latency: an edit starts when the user changes a cell and ends when
+    // the file has been written. Both ends are only ever hit on the UI thread.
+    void markEditStart();
+    void markEditOnDisk();
+    qint64 latencyPercentileNs(int percentile) const;
+
+private:
+    TraceBuffer();
+
+    TraceEvent m_events[TRACE_CAPACITY];
+    std::atomic<quint64> m_next;
+
+    qint64 m_editStartNs;
+    qint64 m_latencies[LATENCY_CAPACITY];
+    int m_latencyCount;
+    int m_latencyNext;
+};
+
+class TraceScope
+{
+public:
+    inline explicit TraceScope(const char* name)
+        : m_name(name)
+        , m_startNs(TraceBuffer::nowNs())
+    {
+    }
+
+    inline ~TraceScope()
+    {
+        TraceBuffer::instance().record(m_name, m_startNs, TraceBuffer::nowNs() - m_startNs);
+    }
+
+private:
+    const char* m_name;
+    qint64 m_startNs;
+};
+
+#define TTK_TRACE_CONCAT_IMPL(a, b) a##b
+#define TTK_TRACE_CONCAT(a, b) TTK_TRACE_CONCAT_IMPL(a, b)
+#define TTK_TRACE_SCOPE(name) TraceScope TTK_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TTK_TRACE_EDIT_START() TraceBuffer::instance().markEditStart()
+#define TTK_TRACE_EDIT_ON_DISK() TraceBuffer::instance().markEditOnDisk()
+
+#else
+
+#define TTK_TRACE_SCOPE(name)
+#define TTK_TRACE_EDIT_START()
+#define TTK_TRACE_EDIT_ON_DISK()
+
+#endif
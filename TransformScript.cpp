@@ -0,0 +1,545 @@
+#include "TransformScript.h"
+
+#include <QByteArray>
+
+#include <cctype>
+#include <climits>
+#include <cstring>
+
+#define MAX_STACK_DEPTH 64
+#define VM_BATCH_FRAMES 256
+#define NO_COLUMN -1
+
+// Instruction bodies for the batched VM. Results overwrite the deepest operand's slot.
+#define VM_SLOT(idx) (pStack + (idx) * VM_BATCH_FRAMES)
+#define VM_PUSH(expr) { int* a = VM_SLOT(sp); for (int k = 0; k < len; k++) a[k] = (expr); sp++; } break;
+#define VM_UNARY(expr) { int* a = VM_SLOT(sp - 1); for (int k = 0; k < len; k++) a[k] = (expr); } break;
+#define VM_BINARY(expr) { int* a = VM_SLOT(sp - 2); const int* b = VM_SLOT(sp - 1); for (int k = 0; k < len; k++) a[k] = (expr); sp--; } break;
+#define VM_TERNARY(expr) { int* a = VM_SLOT(sp - 3); const int* b = VM_SLOT(sp - 2); const int* c = VM_SLOT(sp - 1); for (int k = 0; k < len; k++) a[k] = (expr); sp -= 2; } break;
+
+// Arithmetic on script values is done in 64 bits and saturated back to int, so no expression can
+// overflow or trap (INT_MIN / -1). Out-of-range results are still reported when they are stored.
+static inline int saturate(qint64 value)
+{
+    return static_cast<int>(qBound<qint64>(INT_MIN, value, INT_MAX));
+}
+
+enum Op : quint8
+{
+    OP_CONST,
+    OP_LOAD_COL,
+    OP_STORE_COL,
+    OP_FRAME,
+    OP_INDEX,
+    OP_COUNT,
+    OP_CENTER,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_NEG,
+    OP_NOT,
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_AND,
+    OP_OR,
+    OP_SELECT,
+    OP_MIN,
+    OP_MAX,
+    OP_ABS,
+    OP_CLAMP,
+};
+
+static int columnIndex(const QByteArray& name)
+{
+    for (int i = 0; i < NUM_INPUT_COLUMNS; i++)
+    {
+        if (name == QByteArray(TTK_COLUMNS[i].name).toLower())
+            return i;
+    }
+
+    return NO_COLUMN;
+}
+
+// Recursive-descent parser that emits bytecode as it goes; there is no syntax tree
+class TransformCompiler
+{
+public:
+    TransformCompiler(const QString& source, TransformScript* pScript)
+        : m_src(source.toLatin1())
+        , m_pos(0)
+        , m_line(1)
+        , m_depth(0)
+        , m_pScript(pScript)
+    {
+    }
+
+    bool compile(QString* pError)
+    {
+        skipSpace(true);
+
+        while (m_pos < m_src.size())
+        {
+            if (!statement())
+                break;
+
+            skipSpace(false);
+            if (m_pos < m_src.size() && !accept(";") && !accept("\n"))
+                fail("expected a new line or ';' after the statement");
+
+            skipSpace(true);
+        }
+
+        if (m_error.isEmpty() && m_pScript->m_code.isEmpty())
+            fail("the script has no statements");
+
+        *pError = m_error;
+        return m_error.isEmpty();
+    }
+
+private:
+    QByteArray m_src;
+    int m_pos;
+    int m_line;
+    int m_depth;
+    QString m_error;
+    TransformScript* m_pScript;
+
+    void fail(const QString& msg)
+    {
+        if (m_error.isEmpty())
+            m_error = QString("Line %1: %2").arg(m_line).arg(msg);
+    }
+
+    // Stack effect is tracked so the VM can run on a fixed-size stack
+    void emitOp(quint8 op, int stackEffect, qint32 arg = 0)
+    {
+        TransformScript::Instr instr;
+        instr.op = op;
+        instr.arg = arg;
+        m_pScript->m_code.append(instr);
+
+        m_depth += stackEffect;
+        if (m_depth > MAX_STACK_DEPTH)
+            fail("expression is nested too deeply");
+    }
+
+    void skipSpace(bool bNewlines)
+    {
+        while (m_pos < m_src.size())
+        {
+            char c = m_src[m_pos];
+
+            if (c == '#')
+            {
+                while (m_pos < m_src.size() && m_src[m_pos] != '\n')
+                    m_pos++;
+            }
+            else if (c == '\n' && bNewlines)
+            {
+                m_line++;
+                m_pos++;
+            }
+            else if (c == ' ' || c == '\t' || c == '\r')
+            {
+                m_pos++;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    bool accept(const char* token)
+    {
+        skipSpace(false);
+
+        int len = static_cast<int>(strlen(token));
+        if (m_src.mid(m_pos, len) != token)
+            return false;
+
+        // Don't let "<" match the start of "<=" and so on
+        if (len == 1 && m_pos + 1 < m_src.size() && m_src[m_pos + 1] == '=' && strchr("<>=!", token[0]) != nullptr)
+            return false;
+        if (len == 1 && m_pos + 1 < m_src.size() && (token[0] == '&' || token[0] == '|') && m_src[m_pos + 1] == token[0])
+            return false;
+
+        m_pos += len;
+        if (token[0] == '\n')
+            m_line++;
+
+        return true;
+    }
+
+    void expect(const char* token)
+    {
+        if (!accept(token))
+            fail(QString("expected '%1'").arg(token));
+    }
+
+    QByteArray identifier()
+    {
+        skipSpace(false);
+
+        int start = m_pos;
+        while (m_pos < m_src.size() && (isalnum(static_cast<uchar>(m_src[m_pos])) || m_src[m_pos] == '_'))
+            m_pos++;
+
+        return m_src.mid(start, m_pos - start).toLower();
+    }
+
+    bool statement()
+    {
+        QByteArray target = identifier();
+        int col = columnIndex(target);
+
+        if (col == NO_COLUMN)
+        {
+            fail(target.isEmpty() ? QString("expected a column name") : QString("'%1' is not a column").arg(QString(target)));
+            return false;
+        }
+
+        expect("=");
+        expression();
+        emitOp(OP_STORE_COL, -1, col);
+        m_pScript->m_writtenCols |= 1 << col;
+
+        return m_error.isEmpty();
+    }
+
+    void expression()
+    {
+        logicalOr();
+
+        if (accept("?"))
+        {
+            expression();
+            expect(":");
+            expression();
+            emitOp(OP_SELECT, -2);
+        }
+    }
+
+    void logicalOr()
+    {
+        logicalAnd();
+        while (accept("||"))
+        {
+            logicalAnd();
+            emitOp(OP_OR, -1);
+        }
+    }
+
+    void logicalAnd()
+    {
+        comparison();
+        while (accept("&&"))
+        {
+            comparison();
+            emitOp(OP_AND, -1);
+        }
+    }
+
+    void comparison()
+    {
+        additive();
+
+        static const char* OPS[] = { "==", "!=", "<=", ">=", "<", ">" };
+        static const quint8 CODES[] = { OP_EQ, OP_NE, OP_LE, OP_GE, OP_LT, OP_GT };
+
+        for (int i = 0; i < 6; i++)
+        {
+            if (accept(OPS[i]))
+            {
+                additive();
+                emitOp(CODES[i], -1);
+                return;
+            }
+        }
+    }
+
+    void additive()
+    {
+        multiplicative();
+
+        while (true)
+        {
+            if (accept("+"))
+            {
+                multiplicative();
+                emitOp(OP_ADD, -1);
+            }
+            else if (accept("-"))
+            {
+                multiplicative();
+                emitOp(OP_SUB, -1);
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    void multiplicative()
+    {
+        unary();
+
+        while (true)
+        {
+            quint8 op;
+            if (accept("*"))
+                op = OP_MUL;
+            else if (accept("/"))
+                op = OP_DIV;
+            else if (accept("%"))
+                op = OP_MOD;
+            else
+                return;
+
+            unary();
+            emitOp(op, -1);
+        }
+    }
+
+    void unary()
+    {
+        if (accept("-"))
+        {
+            unary();
+            emitOp(OP_NEG, 0);
+        }
+        else if (accept("!"))
+        {
+            unary();
+            emitOp(OP_NOT, 0);
+        }
+        else
+        {
+            primary();
+        }
+    }
+
+    void primary()
+    {
+        skipSpace(false);
+
+        if (!m_error.isEmpty() || m_pos >= m_src.size() || m_src[m_pos] == '\n' || m_src[m_pos] == ';')
+        {
+            fail("expected a value");
+            return;
+        }
+
+        if (accept("("))
+        {
+            expression();
+            expect(")");
+            return;
+        }
+
+        char c = m_src[m_pos];
+
+        if (isdigit(static_cast<uchar>(c)))
+        {
+            qint64 value = 0;
+            while (m_pos < m_src.size() && isdigit(static_cast<uchar>(m_src[m_pos])) && value <= INT_MAX)
+                value = value * 10 + (m_src[m_pos++] - '0');
+
+            if (value > INT_MAX)
+                fail("number is too large");
+
+            emitOp(OP_CONST, 1, static_cast<qint32>(value));
+            return;
+        }
+
+        QByteArray name = identifier();
+        if (name.isEmpty())
+        {
+            fail(QString("unexpected '%1'").arg(c));
+            return;
+        }
+
+        int col = columnIndex(name);
+        if (col != NO_COLUMN)
+        {
+            emitOp(OP_LOAD_COL, 1, col);
+            m_pScript->m_readCols |= 1 << col;
+        }
+        else if (name == "f")
+            emitOp(OP_FRAME, 1);
+        else if (name == "i")
+            emitOp(OP_INDEX, 1);
+        else if (name == "n")
+            emitOp(OP_COUNT, 1);
+        else if (name == "center")
+            emitOp(OP_CENTER, 1);
+        else if (name == "min")
+            call(2, OP_MIN);
+        else if (name == "max")
+            call(2, OP_MAX);
+        else if (name == "abs")
+            call(1, OP_ABS);
+        else if (name == "clamp")
+            call(3, OP_CLAMP);
+        else
+            fail(QString("unknown name '%1'").arg(QString(name)));
+    }
+
+    void call(int argCount, quint8 op)
+    {
+        expect("(");
+
+        for (int i = 0; i < argCount; i++)
+        {
+            if (i > 0)
+                expect(",");
+            expression();
+        }
+
+        expect(")");
+        emitOp(op, 1 - argCount);
+    }
+};
+
+TransformScript::TransformScript()
+    : m_writtenCols(0)
+    , m_readCols(0)
+{
+}
+
+bool TransformScript::compile(const QString& source, QString* pError)
+{
+    m_code.clear();
+    m_writtenCols = 0;
+    m_readCols = 0;
+
+    TransformCompiler compiler(source, this);
+    if (compiler.compile(pError))
+        return true;
+
+    m_code.clear();
+    return false;
+}
+
+bool TransformScript::run(const TtkFrame* pIn, TtkFrame* pOut, int firstRow, int count, Centering centering, QString* pError) const
+{
+    const Instr* pCode = m_code.constData();
+    const int codeSize = m_code.count();
+    const int center = (centering == Centering::Seven) ? 7 : 0;
+
+    int minValue[NUM_INPUT_COLUMNS];
+    int maxValue[NUM_INPUT_COLUMNS];
+
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        valueBounds(col, centering, &minValue[col], &maxValue[col]);
+
+    // Only assigned columns are stored back, the rest pass through untouched
+    if (pOut != pIn)
+        memcpy(pOut, pIn, count * sizeof(TtkFrame));
+
+    // Each instruction runs across a whole batch of frames before the next one, so
+    // dispatch is paid once per batch and the inner loops are simple enough to vectorize.
+    // Frames never read each other, which makes this the same as running frame by frame.
+    QVector<int> storage((NUM_INPUT_COLUMNS + MAX_STACK_DEPTH + 1) * VM_BATCH_FRAMES);
+    int* pCols = storage.data();
+    int* pStack = pCols + NUM_INPUT_COLUMNS * VM_BATCH_FRAMES;
+
+    for (int base = 0; base < count; base += VM_BATCH_FRAMES)
+    {
+        const int len = qMin(VM_BATCH_FRAMES, count - base);
+
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            if (!(m_readCols & (1 << col)))
+                continue;
+
+            int* pCol = pCols + col * VM_BATCH_FRAMES;
+            for (int k = 0; k < len; k++)
+                pCol[k] = pIn[base + k].values[col];
+        }
+
+        int sp = 0;
+
+        for (int pc = 0; pc < codeSize; pc++)
+        {
+            const Instr& instr = pCode[pc];
+
+            switch (instr.op)
+            {
+            case OP_CONST:     VM_PUSH(instr.arg)
+            case OP_LOAD_COL:  VM_PUSH(pCols[instr.arg * VM_BATCH_FRAMES + k])
+            case OP_FRAME:     VM_PUSH(firstRow + base + k + 1)
+            case OP_INDEX:     VM_PUSH(base + k)
+            case OP_COUNT:     VM_PUSH(count)
+            case OP_CENTER:    VM_PUSH(center)
+            case OP_STORE_COL: sp--; memcpy(pCols + instr.arg * VM_BATCH_FRAMES, VM_SLOT(sp), len * sizeof(int)); break;
+            case OP_ADD:       VM_BINARY(saturate(static_cast<qint64>(a[k]) + b[k]))
+            case OP_SUB:       VM_BINARY(saturate(static_cast<qint64>(a[k]) - b[k]))
+            case OP_MUL:       VM_BINARY(saturate(static_cast<qint64>(a[k]) * b[k]))
+            case OP_DIV:       VM_BINARY(b[k] ? saturate(static_cast<qint64>(a[k]) / b[k]) : 0)
+            case OP_MOD:       VM_BINARY(b[k] ? static_cast<int>(static_cast<qint64>(a[k]) % b[k]) : 0)
+            case OP_EQ:        VM_BINARY(a[k] == b[k])
+            case OP_NE:        VM_BINARY(a[k] != b[k])
+            case OP_LT:        VM_BINARY(a[k] < b[k])
+            case OP_LE:        VM_BINARY(a[k] <= b[k])
+            case OP_GT:        VM_BINARY(a[k] > b[k])
+            case OP_GE:        VM_BINARY(a[k] >= b[k])
+            case OP_AND:       VM_BINARY(a[k] && b[k])
+            case OP_OR:        VM_BINARY(a[k] || b[k])
+            case OP_MIN:       VM_BINARY(qMin(a[k], b[k]))
+            case OP_MAX:       VM_BINARY(qMax(a[k], b[k]))
+            case OP_NEG:       VM_UNARY(saturate(-static_cast<qint64>(a[k])))
+            case OP_NOT:       VM_UNARY(!a[k])
+            case OP_ABS:       VM_UNARY(saturate(qAbs(static_cast<qint64>(a[k]))))
+            case OP_SELECT:    VM_TERNARY(a[k] ? b[k] : c[k])
+            case OP_CLAMP:     VM_TERNARY(qBound(b[k], a[k], c[k]))
+            }
+        }
+
+        // Report the earliest bad frame, and the leftmost column within it
+        int badFrame = len;
+        int badCol = NO_COLUMN;
+
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            if (!(m_writtenCols & (1 << col)))
+                continue;
+
+            const int* pCol = pCols + col * VM_BATCH_FRAMES;
+            for (int k = 0; k < badFrame; k++)
+            {
+                if (pCol[k] < minValue[col] || pCol[k] > maxValue[col])
+                {
+                    badFrame = k;
+                    badCol = col;
+                    break;
+                }
+            }
+        }
+
+        if (badCol != NO_COLUMN)
+        {
+            *pError = QString("Frame %1: %2 would be %3, which is outside the allowed range.")
+                .arg(firstRow + base + badFrame + 1).arg(TTK_COLUMNS[badCol].name).arg(pCols[badCol * VM_BATCH_FRAMES + badFrame]);
+            return false;
+        }
+
+        for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+        {
+            if (!(m_writtenCols & (1 << col)))
+                continue;
+
+            const int* pCol = pCols + col * VM_BATCH_FRAMES;
+            for (int k = 0; k < len; k++)
+                pOut[base + k].values[col] = static_cast<qint8>(pCol[k]);
+        }
+    }
+
+    return true;
+}
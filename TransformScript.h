@@ -0,0 +1,44 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QString>
+
+// Small transform language run once per frame over a span of frames, e.g.
+//
+//     LR = 2 * center - LR               # mirror LR
+//     B = (i % 40) < 3 ? 1 : B           # 3-frame B tap every 40 frames
+//
+// A script is a list of "column = expression" statements separated by newlines or ';'.
+// Columns are A, B, L, LR, UD and DPad (case-insensitive) and read the frame's current
+// values, including assignments made earlier in the script. Other names: f (frame number
+// as shown in the table), i (index within the span), n (span length) and center (7 or 0).
+// Operators follow C: ?: || && == != < <= > >= + - * / % and unary - !. Functions are
+// min(a, b), max(a, b), abs(x) and clamp(x, lo, hi). Division or modulo by zero gives 0.
+//
+// Scripts compile to a flat stack bytecode with no branches, so each frame is one pass
+// over a short instruction array.
+class TransformScript
+{
+public:
+    TransformScript();
+
+    bool compile(const QString& source, QString* pError);
+
+    // Runs over pIn[0..count), writing into pOut; firstRow is the index of pIn[0] in the file.
+    // Fails without a partial result if any assigned value breaks its column's rules.
+    bool run(const TtkFrame* pIn, TtkFrame* pOut, int firstRow, int count, Centering centering, QString* pError) const;
+
+private:
+    struct Instr
+    {
+        quint8 op;
+        qint32 arg;
+    };
+
+    QVector<Instr> m_code;
+    int m_writtenCols;
+    int m_readCols;
+
+    friend class TransformCompiler;
+};
@@ -0,0 +1,144 @@
+#include "TtkFrame.h"
+
+#include <QByteArray>
+#include <QString>
+
+void appendCsvLines(const TtkFrame* pFrames, int count, QByteArray* pOut)
+{
+    // Every value fits in "-128", so a line is at most 6 * 5 bytes including separators
+    int offset = pOut->size();
+    pOut->resize(offset + count * NUM_INPUT_COLUMNS * 5);
+    char* pDst = pOut->data() + offset;
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < NUM_INPUT_COLUMNS; j++)
+        {
+            int value = pFrames[i].values[j];
+
+            if (value < 0)
+            {
+                *pDst++ = '-';
+                value = -value;
+            }
+            if (value >= 100)
+                *pDst++ = '0' + value / 100;
+            if (value >= 10)
+                *pDst++ = '0' + (value / 10) % 10;
+
+            *pDst++ = '0' + value % 10;
+            *pDst++ = (j == NUM_INPUT_COLUMNS - 1) ? '\n' : ',';
+        }
+    }
+
+    pOut->resize(pDst - pOut->constData());
+}
+
+CsvFrameParser::CsvFrameParser(Centering centering)
+    : m_centering(centering)
+{
+}
+
+bool CsvFrameParser::parseLine(const QString& line, TtkFrame* pFrame)
+{
+    return parseLine(line.constData(), line.length(), pFrame);
+}
+
+bool CsvFrameParser::parseLine(const QChar* pChars, int length, TtkFrame* pFrame)
+{
+    switch (m_centering)
+    {
+    case Centering::Seven:
+        return parseValues<Centering::Seven>(pChars, length, pFrame);
+    case Centering::Zero:
+        return parseValues<Centering::Zero>(pChars, length, pFrame);
+    default:
+        break;
+    }
+
+    if (!parseValues<Centering::Unknown>(pChars, length, pFrame))
+        return false;
+
+    discernCentering(*pFrame);
+
+    // The value that gave the centering away can rule out another stick value on the same line
+    if (m_centering == Centering::Unknown)
+        return true;
+
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+    {
+        if (!valueInRange(col, pFrame->values[col], m_centering))
+            return false;
+    }
+
+    return true;
+}
+
+static inline bool isBlank(ushort c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Reads exactly one integer per column, comma separated (blanks around a value are allowed),
+// checking each against the column's bounds for centering C as it goes
+template <Centering C>
+bool CsvFrameParser::parseValues(const QChar* pChars, int length, TtkFrame* pFrame)
+{
+    const ValueBounds& bounds = VALUE_BOUNDS[static_cast<int>(C)];
+    int pos = 0;
+
+    for (int col = 0; col < NUM_INPUT_COLUMNS; col++)
+    {
+        if (col > 0)
+        {
+            if (pos >= length || pChars[pos].unicode() != ',')
+                return false;
+            pos++;
+        }
+
+        while (pos < length && isBlank(pChars[pos].unicode()))
+            pos++;
+
+        bool bNegative = false;
+        if (pos < length && (pChars[pos].unicode() == '-' || pChars[pos].unicode() == '+'))
+            bNegative = pChars[pos++].unicode() == '-';
+
+        int value = 0;
+        int digits = 0;
+
+        // Anything past a few digits is out of range anyway, so stop growing before it can overflow
+        for (; pos < length && pChars[pos].unicode() >= '0' && pChars[pos].unicode() <= '9'; pos++, digits++)
+            value = qMin(value * 10 + (pChars[pos].unicode() - '0'), 1000);
+
+        while (pos < length && isBlank(pChars[pos].unicode()))
+            pos++;
+
+        if (digits == 0)
+            return false;
+
+        if (bNegative)
+            value = -value;
+
+        if (value < bounds.min[col] || value > bounds.max[col])
+            return false;
+
+        pFrame->values[col] = static_cast<qint8>(value);
+    }
+
+    return pos == length;
+}
+
+void CsvFrameParser::discernCentering(const TtkFrame& frame)
+{
+    // The first stick value outside 0..7 can only belong to one centering
+    for (int col = 0; col < NUM_INPUT_COLUMNS && m_centering == Centering::Unknown; col++)
+    {
+        if (!isStickColumn(col))
+            continue;
+
+        if (frame.values[col] > 7)
+            m_centering = Centering::Seven;
+        else if (frame.values[col] < 0)
+            m_centering = Centering::Zero;
+    }
+}
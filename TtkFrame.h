@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ColumnSchema.h"
+
+#include <QVector>
+
+enum class FileStatus
+{
+    Success = 0,
+    WritePermission,
+    Parse,
+    Corrupt,
+};
+
+// One frame of inputs, one signed byte per column (A, B, L, LR, UD, DPad).
+// This is also the exact on-disk layout of a frame in a .ttkb file.
+struct TtkFrame
+{
+    qint8 values[NUM_INPUT_COLUMNS];
+};
+
+static_assert(sizeof(TtkFrame) == NUM_INPUT_COLUMNS, "TtkFrame must stay packed for the .ttkb format");
+
+typedef QVector<TtkFrame> TtkFileData;
+
+class QByteArray;
+class QChar;
+class QString;
+
+// Column rules shared by cell edits, transforms and parsing, looked up in the schema's bounds tables
+inline bool valueInRange(int col, int value, Centering centering)
+{
+    const ValueBounds& bounds = boundsFor(centering);
+    return value >= bounds.min[col] && value <= bounds.max[col];
+}
+
+inline void valueBounds(int col, Centering centering, int* pMin, int* pMax)
+{
+    *pMin = boundsFor(centering).min[col];
+    *pMax = boundsFor(centering).max[col];
+}
+
+// Writes frames as TTK CSV lines ("A,B,L,LR,UD,DPad\n") to the end of pOut
+void appendCsvLines(const TtkFrame* pFrames, int count, QByteArray* pOut);
+
+// Validates CSV lines and converts them to frames, discovering the file's
+// centering from the first stick value that can only belong to one of them.
+class CsvFrameParser
+{
+public:
+    explicit CsvFrameParser(Centering centering = Centering::Unknown);
+
+    bool parseLine(const QString& line, TtkFrame* pFrame);
+    bool parseLine(const QChar* pChars, int length, TtkFrame* pFrame);
+    inline Centering getCentering() const { return m_centering; }
+
+private:
+    Centering m_centering;
+
+    template <Centering C>
+    bool parseValues(const QChar* pChars, int length, TtkFrame* pFrame);
+    void discernCentering(const TtkFrame& frame);
+};
@@ -0,0 +1,260 @@
+#include "TtkbFile.h"
+
+#include "ContentHash.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <cstring>
+
+#define TTKB_MAGIC "TTKB"
+#define TTKB_VERSION 1
+
+// Multiple of 8 frames so every chunk but the last keeps blockChecksum() streamable
+#define CONVERT_CHUNK_FRAMES 4096
+
+struct TtkbHeader
+{
+    char magic[4];
+    quint16 version;
+    quint8 centering;
+    quint8 frameSize;
+    quint32 frameCount;
+    quint32 reserved;
+    quint64 checksum;
+};
+
+static_assert(sizeof(TtkbHeader) == 24, "TtkbHeader must stay packed for the .ttkb format");
+
+// The header as stored, with its multi-byte fields little-endian
+static TtkbHeader makeHeader(quint32 frameCount, Centering centering, quint64 checksum)
+{
+    TtkbHeader header;
+    memcpy(header.magic, TTKB_MAGIC, sizeof(header.magic));
+    header.version = qToLittleEndian<quint16>(TTKB_VERSION);
+    header.centering = static_cast<quint8>(centering);
+    header.frameSize = sizeof(TtkFrame);
+    header.frameCount = qToLittleEndian<quint32>(frameCount);
+    header.reserved = 0;
+    header.checksum = qToLittleEndian<quint64>(checksum);
+    return header;
+}
+
+// The stored header read back into native byte order
+static TtkbHeader readHeader(const void* pBytes)
+{
+    TtkbHeader header;
+    memcpy(&header, pBytes, sizeof(header));
+    header.version = qFromLittleEndian<quint16>(header.version);
+    header.frameCount = qFromLittleEndian<quint32>(header.frameCount);
+    header.reserved = qFromLittleEndian<quint32>(header.reserved);
+    header.checksum = qFromLittleEndian<quint64>(header.checksum);
+    return header;
+}
+
+// True if the buffer holds a complete, intact .ttkb file, whose header is then put in pHeader
+static bool validate(const uchar* pBytes, qint64 size, TtkbHeader* pHeader)
+{
+    if (pBytes == nullptr || size < static_cast<qint64>(sizeof(TtkbHeader)))
+        return false;
+
+    *pHeader = readHeader(pBytes);
+    qint64 frameBytes = static_cast<qint64>(pHeader->frameCount) * sizeof(TtkFrame);
+
+    if (memcmp(pHeader->magic, TTKB_MAGIC, sizeof(pHeader->magic)) != 0
+        || pHeader->version != TTKB_VERSION
+        || pHeader->frameSize != sizeof(TtkFrame)
+        || pHeader->centering > static_cast<quint8>(Centering::Zero)
+        || size != static_cast<qint64>(sizeof(TtkbHeader)) + frameBytes)
+        return false;
+
+    const char* pFrames = reinterpret_cast<const char*>(pBytes + sizeof(TtkbHeader));
+    return blockChecksum(pFrames, frameBytes) == pHeader->checksum;
+}
+
+bool TtkbFile::isTtkbPath(const QString& path)
+{
+    return path.endsWith(TTKB_EXTENSION, Qt::CaseInsensitive);
+}
+
+FileStatus TtkbFile::load(const QString& path, TtkFileData* pData, Centering* pCentering, quint64* pChecksum)
+{
+    QFile fp(path);
+    if (!fp.open(QIODevice::ReadOnly))
+        return FileStatus::WritePermission;
+
+    qint64 size = fp.size();
+    uchar* pBytes = size > 0 ? fp.map(0, size) : nullptr;
+
+    if (pBytes == nullptr)
+        return FileStatus::Corrupt;
+
+    FileStatus status = fromMemory(pBytes, size, pData, pCentering, pChecksum);
+    fp.unmap(pBytes);
+
+    return status;
+}
+
+FileStatus TtkbFile::fromMemory(const uchar* pBytes, qint64 size, TtkFileData* pData, Centering* pCentering, quint64* pChecksum)
+{
+    TtkbHeader header;
+    if (!validate(pBytes, size, &header))
+        return FileStatus::Corrupt;
+
+    pData->resize(header.frameCount);
+    memcpy(pData->data(), pBytes + sizeof(TtkbHeader), header.frameCount * sizeof(TtkFrame));
+
+    // A file that never had a centering-revealing stick value keeps whatever the caller had
+    if (header.centering != static_cast<quint8>(Centering::Unknown))
+        *pCentering = static_cast<Centering>(header.centering);
+
+    if (pChecksum != nullptr)
+        *pChecksum = header.checksum;
+
+    return FileStatus::Success;
+}
+
+bool TtkbFile::readChecksum(const QString& path, quint64* pChecksum)
+{
+    QFile fp(path);
+    if (!fp.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray bytes = fp.read(sizeof(TtkbHeader));
+    if (bytes.size() != sizeof(TtkbHeader))
+        return false;
+
+    TtkbHeader header = readHeader(bytes.constData());
+    if (memcmp(header.magic, TTKB_MAGIC, sizeof(header.magic)) != 0)
+        return false;
+
+    *pChecksum = header.checksum;
+    return true;
+}
+
+QByteArray TtkbFile::toBytes(const TtkFrame* pFrames, int count, Centering centering)
+{
+    const char* pFrameBytes = reinterpret_cast<const char*>(pFrames);
+    int frameBytes = count * sizeof(TtkFrame);
+    TtkbHeader header = makeHeader(count, centering, blockChecksum(pFrameBytes, frameBytes));
+
+    QByteArray bytes;
+    bytes.reserve(sizeof(TtkbHeader) + frameBytes);
+    bytes.append(reinterpret_cast<const char*>(&header), sizeof(TtkbHeader));
+    bytes.append(pFrameBytes, frameBytes);
+
+    return bytes;
+}
+
+bool TtkbFile::save(const QString& path, const TtkFileData& data, Centering centering)
+{
+    // Written aside and renamed over the file, so a failed write leaves the old one intact
+    QSaveFile fp(path);
+    if (!fp.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray bytes = toBytes(data.constData(), data.count(), centering);
+    if (fp.write(bytes) != bytes.size())
+    {
+        fp.cancelWriting();
+        return false;
+    }
+
+    return fp.commit();
+}
+
+FileStatus TtkbFile::csvToTtkb(const QString& csvPath, const QString& ttkbPath, int* pErrorLine)
+{
+    QFile in(csvPath);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Text))
+        return FileStatus::WritePermission;
+
+    QSaveFile out(ttkbPath);
+    if (!out.open(QIODevice::WriteOnly))
+        return FileStatus::WritePermission;
+
+    // Reserve room for the header; it is filled in once the frame count and checksum are known
+    TtkbHeader header = makeHeader(0, Centering::Unknown, 0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(TtkbHeader));
+
+    CsvFrameParser parser;
+    QTextStream ts(&in);
+    TtkFileData chunk;
+    chunk.reserve(CONVERT_CHUNK_FRAMES);
+    quint64 checksum = FNV1A64_OFFSET_BASIS;
+    quint32 frameCount = 0;
+
+    while (!ts.atEnd())
+    {
+        TtkFrame frame;
+
+        if (!parser.parseLine(ts.readLine(), &frame))
+        {
+            *pErrorLine = frameCount + chunk.count() + 1;
+            out.cancelWriting();
+            return FileStatus::Parse;
+        }
+
+        chunk.append(frame);
+
+        if (chunk.count() == CONVERT_CHUNK_FRAMES || ts.atEnd())
+        {
+            const char* pChunkBytes = reinterpret_cast<const char*>(chunk.constData());
+            int chunkBytes = chunk.count() * sizeof(TtkFrame);
+
+            checksum = blockChecksum(pChunkBytes, chunkBytes, checksum);
+            out.write(pChunkBytes, chunkBytes);
+            frameCount += chunk.count();
+            chunk.clear();
+        }
+    }
+
+    header = makeHeader(frameCount, parser.getCentering(), checksum);
+    out.seek(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(TtkbHeader));
+
+    return out.commit() ? FileStatus::Success : FileStatus::WritePermission;
+}
+
+FileStatus TtkbFile::ttkbToCsv(const QString& ttkbPath, const QString& csvPath)
+{
+    QFile in(ttkbPath);
+    if (!in.open(QIODevice::ReadOnly))
+        return FileStatus::WritePermission;
+
+    qint64 size = in.size();
+    uchar* pBytes = size > 0 ? in.map(0, size) : nullptr;
+    TtkbHeader header;
+
+    if (!validate(pBytes, size, &header))
+    {
+        if (pBytes != nullptr)
+            in.unmap(pBytes);
+        return FileStatus::Corrupt;
+    }
+
+    QSaveFile out(csvPath);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        in.unmap(pBytes);
+        return FileStatus::WritePermission;
+    }
+
+    const TtkFrame* pFrames = reinterpret_cast<const TtkFrame*>(pBytes + sizeof(TtkbHeader));
+    QByteArray chunk;
+
+    for (quint32 i = 0; i < header.frameCount; i += CONVERT_CHUNK_FRAMES)
+    {
+        int count = qMin<quint32>(CONVERT_CHUNK_FRAMES, header.frameCount - i);
+
+        chunk.clear();
+        appendCsvLines(pFrames + i, count, &chunk);
+        out.write(chunk);
+    }
+
+    in.unmap(pBytes);
+
+    return out.commit() ? FileStatus::Success : FileStatus::WritePermission;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "TtkFrame.h"
+
+#include <QByteArray>
+#include <QString>
+
+#define TTKB_EXTENSION ".ttkb"
+
+// Native binary input file: a fixed header followed by packed TtkFrames.
+//
+//   0x00  char[4]  magic "TTKB"
+//   0x04  u16      format version
+//   0x06  u8       centering (0 = unknown, 1 = seven, 2 = zero)
+//   0x07  u8       frame size in bytes
+//   0x08  u32      frame count
+//   0x0C  u32      reserved, zero
+//   0x10  u64      blockChecksum() of the frame data
+//
+// All fields are little-endian. Frames are stored exactly as they are held in
+// memory, so loading is a checksum pass and a copy with no text parsing at all.
+class TtkbFile
+{
+public:
+    static bool isTtkbPath(const QString& path);
+
+    static FileStatus load(const QString& path, TtkFileData* pData, Centering* pCentering, quint64* pChecksum = nullptr);
+    static FileStatus fromMemory(const uchar* pBytes, qint64 size, TtkFileData* pData, Centering* pCentering, quint64* pChecksum = nullptr);
+    static bool readChecksum(const QString& path, quint64* pChecksum);
+
+    static QByteArray toBytes(const TtkFrame* pFrames, int count, Centering centering);
+    static bool save(const QString& path, const TtkFileData& data, Centering centering);
+
+    // Streaming conversions for the TTK-facing CSV copy. Neither holds more than
+    // one chunk of frames in memory at a time.
+    static FileStatus csvToTtkb(const QString& csvPath, const QString& ttkbPath, int* pErrorLine);
+    static FileStatus ttkbToCsv(const QString& ttkbPath, const QString& csvPath);
+};
@@ -0,0 +1,278 @@
+// Scripted editing sessions against the real editor window under the offscreen platform.
+// Every scripted step counts as one frame. The step's own work and any events it posts are
+// timed as event processing, and the repaints they trigger are timed as paint. Percentiles
+// are reported per session so UI regressions show up as numbers on a headless machine.
+//
+// Usage: ttk-uibench [frames per file]
+
+#include "InputFile.h"
+#include "TASToolKitEditor.h"
+#include "TtkFrame.h"
+
+#include <QAbstractItemModel>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QScrollBar>
+#include <QTemporaryDir>
+#include <QtWidgets/QApplication>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+#define DEFAULT_BENCH_FRAMES 50000
+#define SCROLL_SWEEP_STEPS 1500
+#define TOGGLE_BURSTS 30
+#define TOGGLES_PER_BURST 10
+#define TOGGLE_ROW_SPREAD 20
+#define NS_PER_MS 1000000.0
+
+// Splits the time spent dispatching events between painting and everything else.
+// Only outermost events are timed, since painting a window dispatches its children's paints.
+class BenchApplication : public QApplication
+{
+public:
+    BenchApplication(int& argc, char** argv)
+        : QApplication(argc, argv)
+        , m_depth(0)
+        , m_eventNs(0)
+        , m_paintNs(0)
+    {
+    }
+
+    bool notify(QObject* receiver, QEvent* event) override
+    {
+        if (m_depth > 0)
+            return QApplication::notify(receiver, event);
+
+        QEvent::Type type = event->type();
+        QElapsedTimer timer;
+        timer.start();
+
+        m_depth++;
+        bool bHandled = QApplication::notify(receiver, event);
+        m_depth--;
+
+        if (type == QEvent::UpdateRequest || type == QEvent::Paint)
+            m_paintNs += timer.nsecsElapsed();
+        else
+            m_eventNs += timer.nsecsElapsed();
+
+        return bHandled;
+    }
+
+    void takeTimes(qint64* pEventNs, qint64* pPaintNs)
+    {
+        *pEventNs = m_eventNs;
+        *pPaintNs = m_paintNs;
+        m_eventNs = 0;
+        m_paintNs = 0;
+    }
+
+private:
+    int m_depth;
+    qint64 m_eventNs;
+    qint64 m_paintNs;
+};
+
+struct SessionTimes
+{
+    QVector<qint64> eventNs;
+    QVector<qint64> paintNs;
+    QVector<qint64> frameNs;
+};
+
+static void runFrame(BenchApplication* pApp, const std::function<void()>& step, SessionTimes* pTimes)
+{
+    qint64 eventNs, paintNs;
+    pApp->takeTimes(&eventNs, &paintNs);
+
+    // The step stands in for an input event's handler, so it counts as event processing
+    QElapsedTimer timer;
+    timer.start();
+    step();
+    qint64 stepNs = timer.nsecsElapsed();
+
+    QCoreApplication::processEvents();
+    pApp->takeTimes(&eventNs, &paintNs);
+
+    pTimes->eventNs.append(stepNs + eventNs);
+    pTimes->paintNs.append(paintNs);
+    pTimes->frameNs.append(timer.nsecsElapsed());
+}
+
+static QString percentiles(QVector<qint64> samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    auto at = [&samples](double fraction)
+    {
+        int idx = qMin(samples.count() - 1, static_cast<int>(fraction * samples.count()));
+        return QString("%1").arg(samples[idx] / NS_PER_MS, 8, 'f', 2);
+    };
+
+    return at(0.5) + at(0.9) + at(0.99) + at(1.0);
+}
+
+static void report(const QString& name, const SessionTimes& times)
+{
+    if (times.frameNs.isEmpty())
+        return;
+
+    std::cout << qPrintable(name.leftJustified(16)) << qPrintable(QString::number(times.frameNs.count()).rightJustified(7)) << std::endl;
+    std::cout << "    event ms  " << qPrintable(percentiles(times.eventNs)) << std::endl;
+    std::cout << "    paint ms  " << qPrintable(percentiles(times.paintNs)) << std::endl;
+    std::cout << "    frame ms  " << qPrintable(percentiles(times.frameNs)) << std::endl;
+}
+
+static bool writeBenchFile(const QString& path, int frameCount, quint32 seed)
+{
+    // Runs of held buttons and stick positions, like a real race rather than noise
+    TtkFileData data(frameCount);
+    TtkFrame frame = {{ 1, 0, 0, 7, 7, 0 }};
+
+    for (int i = 0; i < frameCount; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        quint32 r = seed >> 8;
+
+        if (r % 23 == 0)
+            frame.values[3] = static_cast<qint8>((r >> 5) % 15);
+        if (r % 31 == 0)
+            frame.values[4] = static_cast<qint8>((r >> 9) % 15);
+        if (r % 41 == 0)
+            frame.values[1] = !frame.values[1];
+        if (r % 97 == 0)
+            frame.values[2] = !frame.values[2];
+
+        frame.values[5] = (r % 401 == 0) ? 1 : 0;
+        data[i] = frame;
+    }
+
+    QByteArray csv;
+    appendCsvLines(data.constData(), data.count(), &csv);
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(csv) == csv.size();
+}
+
+static QAction* findAction(QWidget* pWindow, const QString& menuTitle, const QString& text)
+{
+    for (QMenu* pMenu : pWindow->findChildren<QMenu*>())
+    {
+        if (pMenu->title() != menuTitle)
+            continue;
+
+        for (QAction* pAction : pMenu->actions())
+        {
+            if (pAction->text() == text)
+                return pAction;
+        }
+    }
+
+    return nullptr;
+}
+
+int main(int argc, char* argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    BenchApplication a(argc, argv);
+    QStringList args = a.arguments();
+
+    int frameCount = (args.count() > 1) ? args[1].toInt() : DEFAULT_BENCH_FRAMES;
+    if (frameCount <= 0)
+        frameCount = DEFAULT_BENCH_FRAMES;
+
+    QTemporaryDir dir;
+    QString playerPath = dir.filePath("player.csv");
+    QString ghostPath = dir.filePath("ghost.csv");
+
+    if (!dir.isValid() || !writeBenchFile(playerPath, frameCount, 1) || !writeBenchFile(ghostPath, frameCount, 2))
+    {
+        std::cerr << "Could not write the bench files" << std::endl;
+        return 1;
+    }
+
+    TASToolKitEditor w;
+    w.openPreloadedFile(playerPath, InputFile::readFile(playerPath, Centering::Unknown));
+    w.openPreloadedFile(ghostPath, InputFile::readFile(ghostPath, Centering::Unknown));
+    w.show();
+    QCoreApplication::processEvents();
+
+    // The player table is the one on the left
+    QList<QTableView*> tables = w.findChildren<QTableView*>();
+    std::sort(tables.begin(), tables.end(), [&w](QTableView* a, QTableView* b) { return a->mapTo(&w, QPoint()).x() < b->mapTo(&w, QPoint()).x(); });
+
+    QAction* pScrollTogether = findAction(&w, "File", "Scroll Together");
+    QAction* pUndo = findAction(&w, "Player", "Undo");
+    QAction* pRedo = findAction(&w, "Player", "Redo");
+
+    if (tables.count() < 2 || !pScrollTogether || !pUndo || !pRedo)
+    {
+        std::cerr << "The editor window doesn't look as expected" << std::endl;
+        return 1;
+    }
+
+    QTableView* pPlayerTable = tables[0];
+    QTableView* pGhostTable = tables[1];
+
+    std::cout << "ttk-uibench: " << frameCount << " frames per file, platform " << qPrintable(QGuiApplication::platformName()) << std::endl;
+    std::cout << "session          frames       p50     p90     p99     max" << std::endl;
+
+    // Scroll together: sweep the player down and the ghost back up, each dragging the other along
+    SessionTimes scrollTimes;
+    pScrollTogether->setChecked(true);
+
+    for (QTableView* pTable : { pPlayerTable, pGhostTable })
+    {
+        QScrollBar* pBar = pTable->verticalScrollBar();
+        bool bDown = (pTable == pPlayerTable);
+
+        for (int i = 1; i <= SCROLL_SWEEP_STEPS; i++)
+        {
+            int value = static_cast<int>(static_cast<qint64>(pBar->maximum()) * i / SCROLL_SWEEP_STEPS);
+            runFrame(&a, [pBar, value, bDown]() { pBar->setValue(bDown ? value : pBar->maximum() - value); }, &scrollTimes);
+        }
+    }
+
+    pScrollTogether->setChecked(false);
+    report("scroll-together", scrollTimes);
+
+    // Checkbox toggle bursts on the visible rows, each toggle going through onCellClicked
+    SessionTimes toggleTimes;
+    quint32 seed = 7;
+    int toggles = 0;
+
+    for (int burst = 0; burst < TOGGLE_BURSTS; burst++)
+    {
+        pPlayerTable->verticalScrollBar()->setValue(pPlayerTable->verticalScrollBar()->maximum() * burst / TOGGLE_BURSTS);
+        QCoreApplication::processEvents();
+
+        int topRow = qMax(0, pPlayerTable->rowAt(0));
+
+        for (int i = 0; i < TOGGLES_PER_BURST; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            QModelIndex index = pPlayerTable->model()->index(topRow + (seed >> 8) % TOGGLE_ROW_SPREAD, FRAMECOUNT_COLUMN + (seed >> 20) % 3);
+
+            runFrame(&a, [pPlayerTable, index]() { emit pPlayerTable->clicked(index); }, &toggleTimes);
+            toggles++;
+        }
+    }
+
+    report("toggle-burst", toggleTimes);
+
+    // Held undo then held redo, one step per key repeat
+    SessionTimes undoTimes;
+
+    for (int i = 0; i < toggles; i++)
+        runFrame(&a, [pUndo]() { pUndo->trigger(); }, &undoTimes);
+    for (int i = 0; i < toggles; i++)
+        runFrame(&a, [pRedo]() { pRedo->trigger(); }, &undoTimes);
+
+    report("undo-redo-held", undoTimes);
+
+    return 0;
+}
@@ -1,10 +1,44 @@
 #include "TASToolKitEditor.h"
+#include "InputFile.h"
+
+#include <QCommandLineParser>
+#include <QFileInfo>
 #include <QtWidgets/QApplication>
 
+#include <future>
+#include <vector>
+
+// Usage: TASToolKitEditor [player file] [ghost file]
+#define MAX_CMDLINE_FILES 2
+
 int main(int argc, char *argv[])
 {
+    // QApplication takes its own options (-platform, -style, ...) out of the arguments first
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("player", "Input file to open as the player.", "[player]");
+    parser.addPositionalArgument("ghost", "Input file to open as the ghost.", "[ghost]");
+    parser.process(a);
+
+    // Read any files given on the command line while the window starts up
+    QStringList filePaths;
+    std::vector<std::future<LoadedFile>> preloads;
+
+    for (const QString& arg : parser.positionalArguments().mid(0, MAX_CMDLINE_FILES))
+    {
+        QString filePath = QFileInfo(arg).absoluteFilePath();
+        filePaths.append(filePath);
+        preloads.push_back(std::async(std::launch::async, InputFile::readFile, filePath, Centering::Unknown));
+    }
+
     TASToolKitEditor w;
+
+    // Adopt the files before showing the window so the first frame already has them
+    for (int i = 0; i < filePaths.count(); i++)
+        w.openPreloadedFile(filePaths[i], preloads[i].get());
+
     w.show();
     return a.exec();
 }